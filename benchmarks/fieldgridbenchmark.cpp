@@ -0,0 +1,69 @@
+/*
+ * Example of the OpenGL usage with SDL2
+ * Copyright (C) 2013 Matteo De Carlo <matteo.dek@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * Steps a FieldGrid with the 5 and the 9 point stencil, on the calling
+ * thread only and on a JobSystem, and prints the cells computed per second.
+ * Convergence skipping is disabled, every cell is computed at every step.
+ *
+ * usage: fieldgrid-benchmark [size] [steps]
+ */
+
+#include "simulation/fieldgrid.h"
+#include "jobs/jobsystem.h"
+#include <cstdio>
+#include <cstdlib>
+
+using namespace sm;
+
+namespace {
+    void run(const char *name, const StencilWeights &weights, int size, int steps, JobSystem *jobs)
+    {
+        FieldGrid grid(size, size);
+        grid.setWeights(weights);
+        grid.setConvergenceThreshold(-1.0f);
+        for (int y = 0; y < size; y += 37)
+            for (int x = 0; x < size; x += 41)
+                grid.setSource(x, y, 1.0f);
+
+        for (int s = 0; s < steps; s++)
+            grid.step(jobs);
+
+        std::printf("%-8s %-10s %8.1f Mcells/s\n", name,
+                    jobs != nullptr ? "jobsystem" : "single",
+                    grid.getCellsPerSecond() * 1e-6);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const int size = argc > 1 ? std::atoi(argv[1]) : 1024;
+    const int steps = argc > 2 ? std::atoi(argv[2]) : 100;
+
+    const StencilWeights fivePoint = StencilWeights::diffusion(0.2f, 0.01f);
+    const StencilWeights ninePoint(0.5f, 0.1f, 0.025f);
+
+    JobSystem jobs;
+    std::printf("%dx%d grid, %d steps, %d workers\n", size, size, steps, jobs.getWorkerCount());
+    run("5 point", fivePoint, size, steps, nullptr);
+    run("5 point", fivePoint, size, steps, &jobs);
+    run("9 point", ninePoint, size, steps, nullptr);
+    run("9 point", ninePoint, size, steps, &jobs);
+    return 0;
+}
@@ -0,0 +1,80 @@
+/*
+ * Example of the OpenGL usage with SDL2
+ * Copyright (C) 2013 Matteo De Carlo <matteo.dek@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * Times the same parallelFor workload with 0 to N-1 JobSystem workers (the
+ * calling thread always works too) and prints the speedup over 1 thread.
+ *
+ * usage: jobsystem-benchmark [items] [repeats]
+ */
+
+#include "jobs/jobsystem.h"
+#include "timer.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+using namespace sm;
+
+namespace {
+    // a few hundred flops per item, so the jobs dominate over scheduling
+    void work(std::vector<float> &data, int begin, int end)
+    {
+        for (int i = begin; i < end; i++) {
+            float value = data[i];
+            for (int k = 0; k < 64; k++)
+                value = std::sqrt(value * value + 1.0f) * 0.5f;
+            data[i] = value;
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const int items = argc > 1 ? std::atoi(argv[1]) : 1 << 20;
+    const int repeats = argc > 2 ? std::atoi(argv[2]) : 20;
+    int cores = int(std::thread::hardware_concurrency());
+    if (cores < 1)
+        cores = 1;
+
+    std::vector<float> data(items, 1.0f);
+    double singleSeconds = 0.0;
+
+    std::printf("threads  seconds  speedup  stolen\n");
+    for (int threads = 1; threads <= cores; threads++) {
+        JobSystem jobs(threads - 1);
+        const JobSystem::RangeFunction body = [&data](int begin, int end) { work(data, begin, end); };
+
+        // warm up the workers and the caches
+        jobs.parallelFor(0, items, body);
+
+        Timer timer;
+        for (int r = 0; r < repeats; r++)
+            jobs.parallelFor(0, items, body);
+        const double seconds = timer.getElapsedSeconds();
+        if (threads == 1)
+            singleSeconds = seconds;
+
+        std::printf("%7d  %7.3f  %7.2f  %6ld\n", threads, seconds,
+                    seconds > 0.0 ? singleSeconds / seconds : 0.0, jobs.getStolenCount());
+    }
+    return 0;
+}
@@ -21,6 +21,13 @@
 
 using namespace sm;
 
+Camera::Camera()
+    : vPosition(0, 0, 0), vForward(0, 0, -1), vUp(0, 1, 0)
+{
+    mProjection.loadIdentity();
+    dirty = true;
+}
+
 Matrix44 Camera::getCameraMatrixRotationOnly()
 {
     Vector3 x, z;
@@ -59,14 +66,32 @@ Matrix44 Camera::getCameraMatrixRotationOnly()
     return m;
 }
 
-Matrix44 Camera::getCameraMatrix()
+void Camera::update()
 {
-    Matrix44 m = this->getCameraMatrixRotationOnly();
+    if (!dirty)
+        return;
+
+    // rotation part, rows are the camera axes
+    state.view = this->getCameraMatrixRotationOnly();
+
+    // translation is -R * position, no need of a full multiplication
+    Matrix44 &m = state.view;
+    for (int row = 0; row < 3; row++) {
+        m[12+row] = -(m[row] * vPosition[0] + m[4+row] * vPosition[1] + m[8+row] * vPosition[2]);
+    }
+
+    // inverse of a rigid transform: transposed rotation, position as translation
+    Matrix44 &inv = state.inverseView;
+    for (int row = 0; row < 3; row++) {
+        for (int col = 0; col < 3; col++)
+            inv[col*4+row] = m[row*4+col];
+        inv[row*4+3] = 0.0f;
+        inv[12+row] = vPosition[row];
+    }
+    inv[15] = 1.0f;
 
-    // Apply translation too
-    Matrix44 trans;
-    //TODO MMath::TranslationMatrix44(trans, -vOrigin[0], -vOrigin[1], -vOrigin[2]);
-    trans.loadTranslationMatrix(-vPosition);
+    state.viewProjection = mProjection * state.view;
+    Frustum::extractPlanes(state.viewProjection, state.planes);
 
-    return m * trans;
+    dirty = false;
 }
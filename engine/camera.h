@@ -21,9 +21,9 @@
 #define SMCAMERA_H
 
 #include "math/math.h"
+#include "math/frustum.h"
 
 //TODO angle
-//TODO frustum
 
 namespace sm {
 
@@ -31,18 +31,39 @@ namespace sm {
  * @brief Class implementing the abstraction to manage a virtual camera into
  * the 3D space
  * 
- * Note that all calculation are made in "getCameraMatrix" or "getMatrix" functions
+ * Setters only change the internal status and mark it dirty. The view
+ * matrix and everything derived from it (inverse, view-projection, world
+ * space frustum planes) are computed at most once after each change, the
+ * first time one of them is asked, so every system reading the camera in
+ * the same frame shares the same snapshot.
  * 
  * TODO general usage description
  * 
  */
 class Camera
 {
+public:
+    /**
+     * @brief Everything derived from the camera status, computed together
+     */
+    struct CameraState {
+        Matrix44 view;              // world -> eye (the camera matrix)
+        Matrix44 inverseView;       // eye -> world
+        Matrix44 viewProjection;    // world -> clip
+        Vector4  planes[Frustum::PLANE_COUNT]; // world space frustum planes
+    };
+
 private:
     Vector3 vPosition; // Where am I?
     Vector3 vForward;  // Where am I going?
     Vector3 vUp;       // Which way is up?
     
+    Matrix44    mProjection;
+    CameraState state;
+    bool        dirty;
+    
+    void update();
+    
 public:
     /**
      * @brief internal values set to default
@@ -64,6 +85,7 @@ public:
      */
     void setPosition(const Vector3 &vector) {
         this->vPosition = vector;
+        this->dirty = true;
     }
     
     /**
@@ -75,7 +97,67 @@ public:
         return vPosition;
     }
     
-    Matrix44 getCameraMatrix();
+    /**
+     * @brief sets where the camera looks and which way is up
+     * 
+     * Both vectors must be normalized and orthogonal.
+     */
+    void setOrientation(const Vector3 &forward, const Vector3 &up) {
+        this->vForward = forward;
+        this->vUp = up;
+        this->dirty = true;
+    }
+    void setForward(const Vector3 &forward) {
+        this->vForward = forward;
+        this->dirty = true;
+    }
+    void setUp(const Vector3 &up) {
+        this->vUp = up;
+        this->dirty = true;
+    }
+    Vector3 getForward() {
+        return vForward;
+    }
+    Vector3 getUp() {
+        return vUp;
+    }
+    
+    /**
+     * @brief sets the projection used for the view-projection matrix and the
+     * frustum planes, e.g. Frustum::GetProjectionMatrix()
+     */
+    void setProjectionMatrix(const Matrix44 &projection) {
+        this->mProjection.copyFrom(projection);
+        this->dirty = true;
+    }
+    const Matrix44& getProjectionMatrix() const {
+        return mProjection;
+    }
+    
+    /** @brief the view matrix, world to eye */
+    const Matrix44& getCameraMatrix() {
+        update();
+        return state.view;
+    }
+    const Matrix44& getInverseCameraMatrix() {
+        update();
+        return state.inverseView;
+    }
+    const Matrix44& getViewProjectionMatrix() {
+        update();
+        return state.viewProjection;
+    }
+    /** @brief world space frustum planes, see Frustum::extractPlanes() */
+    const Vector4* getFrustumPlanes() {
+        update();
+        return state.planes;
+    }
+    /** @brief all the derived matrices at once */
+    const CameraState& getState() {
+        update();
+        return state;
+    }
+    
     Matrix44 getCameraMatrixRotationOnly();
     
 };
@@ -0,0 +1,151 @@
+/*
+ * Example of the OpenGL usage with SDL2
+ * Copyright (C) 2013 Matteo De Carlo <matteo.dek@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "archetype.h"
+#include "../errorhandling.h"
+
+using namespace sm;
+
+namespace {
+    size_t alignUp(size_t value, size_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    // operator new alignment we rely on
+    const size_t CHUNK_ALIGNMENT = 16;
+}
+
+const size_t Archetype::CHUNK_SIZE;
+
+Archetype::Archetype(ComponentMask mask)
+    : mask(mask), count(0)
+{
+    for (int i = 0; i < ComponentRegistry::MAX_COMPONENT_TYPES; i++) {
+        addEdge[i] = nullptr;
+        removeEdge[i] = nullptr;
+        columnOf[i] = -1;
+        if (mask & (ComponentMask(1) << i)) {
+            columnOf[i] = int(types.size());
+            types.push_back(i);
+        }
+    }
+    columnOffset.resize(types.size());
+    columnSize.resize(types.size());
+
+    size_t rowSize = sizeof(Entity);
+    for (size_t c = 0; c < types.size(); c++) {
+        const ComponentInfo &info = ComponentRegistry::info(types[c]);
+        if (info.alignment > CHUNK_ALIGNMENT)
+            emitErrorFatal("component alignment not supported", 1);
+        columnSize[c] = info.size;
+        rowSize += info.size;
+    }
+
+    // as many rows as fit in a chunk once the arrays are aligned
+    chunkSize = CHUNK_SIZE;
+    capacity = int(chunkSize / rowSize);
+    while (true) {
+        if (capacity < 1) {
+            // huge components, one row per chunk
+            capacity = 1;
+            chunkSize = 0;
+        }
+        size_t offset = sizeof(Entity) * capacity;
+        for (size_t c = 0; c < types.size(); c++) {
+            offset = alignUp(offset, ComponentRegistry::info(types[c]).alignment);
+            columnOffset[c] = offset;
+            offset += columnSize[c] * capacity;
+        }
+        if (chunkSize == 0)
+            chunkSize = offset;
+        if (offset <= chunkSize)
+            break;
+        capacity--;
+    }
+}
+
+Archetype::~Archetype()
+{
+    Entity moved;
+    while (count > 0)
+        removeRow(count - 1, moved);
+    for (size_t i = 0; i < chunks.size(); i++)
+        ::operator delete(chunks[i]);
+}
+
+int Archetype::pushRow(const Entity &entity)
+{
+    const int row = count;
+    if (row / capacity == int(chunks.size()))
+        chunks.push_back(static_cast<unsigned char*>(::operator new(chunkSize)));
+    getEntities(row / capacity)[row % capacity] = entity;
+    count++;
+    return row;
+}
+
+void Archetype::constructComponent(int row, ComponentTypeId type)
+{
+    ComponentRegistry::info(type).construct(getComponent(row, type));
+}
+
+bool Archetype::removeRow(int row, Entity &moved)
+{
+    for (size_t c = 0; c < types.size(); c++)
+        ComponentRegistry::info(types[c]).destroy(getComponent(row, types[c]));
+    return fillHole(row, moved);
+}
+
+bool Archetype::fillHole(int row, Entity &moved)
+{
+    const int last = count - 1;
+    bool rowMoved = false;
+    if (row != last) {
+        for (size_t c = 0; c < types.size(); c++)
+            ComponentRegistry::info(types[c]).relocate(getComponent(row, types[c]), getComponent(last, types[c]));
+        moved = getEntity(last);
+        getEntities(row / capacity)[row % capacity] = moved;
+        rowMoved = true;
+    }
+    count--;
+
+    // keep one spare chunk to avoid thrashing at a chunk boundary
+    const int usedChunks = (count + capacity - 1) / capacity;
+    while (int(chunks.size()) > usedChunks + 1) {
+        ::operator delete(chunks.back());
+        chunks.pop_back();
+    }
+    return rowMoved;
+}
+
+int Archetype::moveRowFrom(Archetype &source, int row, Entity &moved, bool &rowMoved)
+{
+    const int newRow = pushRow(source.getEntity(row));
+    for (size_t c = 0; c < source.types.size(); c++) {
+        const ComponentTypeId type = source.types[c];
+        const ComponentInfo &info = ComponentRegistry::info(type);
+        void *from = source.getComponent(row, type);
+        if (hasType(type))
+            info.relocate(getComponent(newRow, type), from);
+        else
+            info.destroy(from);
+    }
+    rowMoved = source.fillHole(row, moved);
+    return newRow;
+}
@@ -0,0 +1,122 @@
+/*
+ * Example of the OpenGL usage with SDL2
+ * Copyright (C) 2013 Matteo De Carlo <matteo.dek@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef SM_ARCHETYPE_H
+#define SM_ARCHETYPE_H
+
+#include "component.h"
+#include <vector>
+
+namespace sm {
+
+/**
+ * @brief Storage of all the entities having exactly the same components
+ *
+ * Entities are stored in fixed size chunks. Inside a chunk every component
+ * type has its own contiguous array (structure of arrays), next to the array
+ * of the entity ids, so a system reading two components of every entity
+ * walks two dense arrays.
+ *
+ * Rows are packed: row "r" is row r % capacity of chunk r / capacity, and
+ * removing a row moves the last one into its place.
+ */
+class Archetype
+{
+public:
+    static const size_t CHUNK_SIZE = 16 * 1024;
+
+    explicit Archetype(ComponentMask mask);
+    ~Archetype();
+
+    ComponentMask getMask() const { return mask; }
+    bool hasType(ComponentTypeId type) const { return columnOf[type] >= 0; }
+
+    /** Rows per chunk */
+    int getCapacity() const { return capacity; }
+    int getEntityCount() const { return count; }
+    int getChunkCount() const { return int(chunks.size()); }
+    /** Used rows of "chunk", only the last chunk isn't full */
+    int getChunkEntityCount(int chunk) const {
+        int remaining = count - chunk * capacity;
+        return remaining < capacity ? remaining : capacity;
+    }
+
+    Entity* getEntities(int chunk) { return reinterpret_cast<Entity*>(chunks[chunk]); }
+    void* getColumn(int chunk, ComponentTypeId type) {
+        return chunks[chunk] + columnOffset[columnOf[type]];
+    }
+    template<class T>
+    T* getComponents(int chunk) { return static_cast<T*>(getColumn(chunk, ComponentRegistry::typeOf<T>())); }
+
+    Entity getEntity(int row) { return getEntities(row / capacity)[row % capacity]; }
+    void* getComponent(int row, ComponentTypeId type) {
+        const int column = columnOf[type];
+        return chunks[row / capacity] + columnOffset[column] + (row % capacity) * columnSize[column];
+    }
+
+    /**
+     * @brief Appends a row for "entity"
+     *
+     * The components of the new row are NOT constructed.
+     * @return int the new row
+     */
+    int pushRow(const Entity &entity);
+    /** Default constructs the component "type" of "row" */
+    void constructComponent(int row, ComponentTypeId type);
+    /**
+     * @brief Destroys the components of "row" and moves the last row there
+     *
+     * @param moved receives the entity that now lives in "row", if any
+     * @return bool true if a row was moved
+     */
+    bool removeRow(int row, Entity &moved);
+    /**
+     * @brief Moves row "row" of "source" into a new row of this archetype
+     *
+     * The components both archetypes have are moved, the ones only this
+     * archetype has are left unconstructed, the ones only "source" has are
+     * destroyed, and the row is removed from "source".
+     */
+    int moveRowFrom(Archetype &source, int row, Entity &moved, bool &rowMoved);
+
+    /** Archetype reached by adding or removing one component type, cached */
+    Archetype* addEdge[ComponentRegistry::MAX_COMPONENT_TYPES];
+    Archetype* removeEdge[ComponentRegistry::MAX_COMPONENT_TYPES];
+
+private:
+    Archetype(const Archetype&);
+    Archetype& operator=(const Archetype&);
+
+    /** Moves the last row into the (already destroyed) "row" */
+    bool fillHole(int row, Entity &moved);
+
+    ComponentMask mask;
+    std::vector<ComponentTypeId> types;
+    std::vector<size_t> columnOffset;  // per column, inside a chunk
+    std::vector<size_t> columnSize;
+    int columnOf[ComponentRegistry::MAX_COMPONENT_TYPES]; // -1 if absent
+    size_t chunkSize;
+    int capacity;
+    int count;
+    std::vector<unsigned char*> chunks;
+};
+
+}
+
+#endif // SM_ARCHETYPE_H
@@ -0,0 +1,50 @@
+/*
+ * Example of the OpenGL usage with SDL2
+ * Copyright (C) 2013 Matteo De Carlo <matteo.dek@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "component.h"
+#include "../errorhandling.h"
+#include <atomic>
+#include <mutex>
+
+using namespace sm;
+
+namespace {
+    ComponentInfo registeredTypes[ComponentRegistry::MAX_COMPONENT_TYPES];
+    std::atomic<int> registeredCount(0);
+    std::mutex registerMutex;
+}
+
+const int ComponentRegistry::MAX_COMPONENT_TYPES;
+
+ComponentTypeId ComponentRegistry::registerType(const ComponentInfo &info)
+{
+    std::lock_guard<std::mutex> lock(registerMutex);
+    int id = registeredCount;
+    if (id >= MAX_COMPONENT_TYPES) {
+        emitErrorFatal("too many component types", 1);
+    }
+    registeredTypes[id] = info;
+    registeredCount = id + 1;
+    return id;
+}
+
+const ComponentInfo& ComponentRegistry::info(ComponentTypeId type)
+{
+    return registeredTypes[type];
+}
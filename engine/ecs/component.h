@@ -0,0 +1,111 @@
+/*
+ * Example of the OpenGL usage with SDL2
+ * Copyright (C) 2013 Matteo De Carlo <matteo.dek@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef SM_COMPONENT_H
+#define SM_COMPONENT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+
+namespace sm {
+
+typedef int ComponentTypeId;
+/** Set of component types, bit "id" for each ComponentTypeId */
+typedef uint64_t ComponentMask;
+
+/**
+ * @brief Entity identifier
+ *
+ * "index" is reused after the entity is destroyed, "generation" tells the
+ * old entity from the new one.
+ */
+struct Entity
+{
+    uint32_t index;
+    uint32_t generation;
+
+    bool operator==(const Entity &other) const { return index == other.index && generation == other.generation; }
+    bool operator!=(const Entity &other) const { return !(*this == other); }
+};
+
+/**
+ * @brief Type erased operations on a component type
+ *
+ * Components may be any default constructible, movable type, e.g. Vector3
+ * or Matrix44: chunks are moved around with these functions, never with
+ * memcpy.
+ */
+struct ComponentInfo
+{
+    size_t size;
+    size_t alignment;
+    void (*construct)(void *destination);
+    /** Move constructs "destination" from "source", then destroys "source" */
+    void (*relocate)(void *destination, void *source);
+    void (*destroy)(void *component);
+};
+
+/**
+ * @brief Assigns a ComponentTypeId to every component type on first use
+ */
+class ComponentRegistry
+{
+public:
+    static const int MAX_COMPONENT_TYPES = 64;
+
+    template<class T>
+    static ComponentTypeId typeOf() {
+        // initialization of function statics is thread safe
+        static const ComponentTypeId id = registerType(makeInfo<T>());
+        return id;
+    }
+
+    template<class T>
+    static ComponentMask maskOf() { return ComponentMask(1) << typeOf<T>(); }
+
+    static const ComponentInfo& info(ComponentTypeId type);
+
+private:
+    static ComponentTypeId registerType(const ComponentInfo &info);
+
+    template<class T> static void construct(void *destination) { new (destination) T(); }
+    template<class T> static void relocate(void *destination, void *source) {
+        T *from = static_cast<T*>(source);
+        new (destination) T(std::move(*from));
+        from->~T();
+    }
+    template<class T> static void destroy(void *component) { static_cast<T*>(component)->~T(); }
+
+    template<class T>
+    static ComponentInfo makeInfo() {
+        ComponentInfo info;
+        info.size = sizeof(T);
+        info.alignment = alignof(T);
+        info.construct = &construct<T>;
+        info.relocate = &relocate<T>;
+        info.destroy = &destroy<T>;
+        return info;
+    }
+};
+
+}
+
+#endif // SM_COMPONENT_H
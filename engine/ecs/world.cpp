@@ -0,0 +1,131 @@
+/*
+ * Example of the OpenGL usage with SDL2
+ * Copyright (C) 2013 Matteo De Carlo <matteo.dek@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "world.h"
+#include "../errorhandling.h"
+
+using namespace sm;
+
+World::World()
+    : aliveCount(0)
+{
+    emptyArchetype = getArchetype(0);
+}
+
+World::~World()
+{
+    // archetypes destroy their components
+}
+
+Entity World::createEntity()
+{
+    Entity entity;
+    if (!freeIndices.empty()) {
+        entity.index = freeIndices.back();
+        freeIndices.pop_back();
+    } else {
+        entity.index = uint32_t(records.size());
+        Record record;
+        record.archetype = nullptr;
+        record.row = -1;
+        record.generation = 0;
+        records.push_back(record);
+    }
+
+    Record &record = records[entity.index];
+    entity.generation = record.generation;
+    record.archetype = emptyArchetype;
+    record.row = emptyArchetype->pushRow(entity);
+    aliveCount++;
+    return entity;
+}
+
+void World::destroyEntity(Entity entity)
+{
+    if (!isAlive(entity))
+        return;
+
+    Record &record = records[entity.index];
+    Entity moved;
+    if (record.archetype->removeRow(record.row, moved))
+        records[moved.index].row = record.row;
+
+    record.archetype = nullptr;
+    record.row = -1;
+    record.generation++;
+    freeIndices.push_back(entity.index);
+    aliveCount--;
+}
+
+void* World::addComponent(Entity entity, ComponentTypeId type)
+{
+    // a stale handle would write into the entity now using its index
+    if (!isAlive(entity))
+        emitErrorFatal("component added to a destroyed entity", 1);
+
+    Record &record = records[entity.index];
+    Archetype *source = record.archetype;
+    if (!source->hasType(type)) {
+        Archetype *&target = source->addEdge[type];
+        if (target == nullptr)
+            target = getArchetype(source->getMask() | (ComponentMask(1) << type));
+        moveEntity(entity, target);
+        target->constructComponent(record.row, type);
+    }
+    return record.archetype->getComponent(record.row, type);
+}
+
+void World::removeComponent(Entity entity, ComponentTypeId type)
+{
+    if (!isAlive(entity))
+        return;
+
+    Archetype *source = records[entity.index].archetype;
+    if (!source->hasType(type))
+        return;
+
+    Archetype *&target = source->removeEdge[type];
+    if (target == nullptr)
+        target = getArchetype(source->getMask() & ~(ComponentMask(1) << type));
+    moveEntity(entity, target);
+}
+
+Archetype* World::getArchetype(ComponentMask mask)
+{
+    std::unordered_map<ComponentMask, Archetype*>::iterator found = archetypes.find(mask);
+    if (found != archetypes.end())
+        return found->second;
+
+    Archetype *archetype = new Archetype(mask);
+    archetypeList.push_back(std::unique_ptr<Archetype>(archetype));
+    archetypes[mask] = archetype;
+    return archetype;
+}
+
+void World::moveEntity(Entity entity, Archetype *target)
+{
+    Record &record = records[entity.index];
+    Entity moved;
+    bool rowMoved;
+    const int row = target->moveRowFrom(*record.archetype, record.row, moved, rowMoved);
+    if (rowMoved)
+        records[moved.index].row = record.row;
+    record.archetype = target;
+    record.row = row;
+}
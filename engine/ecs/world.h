@@ -0,0 +1,169 @@
+/*
+ * Example of the OpenGL usage with SDL2
+ * Copyright (C) 2013 Matteo De Carlo <matteo.dek@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef SM_WORLD_H
+#define SM_WORLD_H
+
+#include "archetype.h"
+#include <memory>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+namespace sm {
+
+/**
+ * @brief Entity-component store, entities grouped by archetype
+ *
+ * Components are plain values (Vector3, Matrix44, small structs) stored in
+ * the chunks of the archetype of their entity. Adding or removing a
+ * component moves the entity to another archetype, destroying an entity
+ * swaps the last row of its archetype into its place: both are O(1).
+ *
+ * Queries walk the chunks of every archetype having the requested
+ * components, linearly:
+ *
+ *     world.forEachChunk<Vector3, Velocity>(
+ *         [](int count, const Entity *entities, Vector3 *position, Velocity *velocity) {...});
+ *
+ * Chunks don't share data, so different chunks can be processed by
+ * different threads. Entities and components must not be added or removed
+ * while iterating.
+ */
+class World
+{
+public:
+    World();
+    ~World();
+
+    Entity createEntity();
+    void destroyEntity(Entity entity);
+    bool isAlive(Entity entity) const {
+        return entity.index < records.size() && records[entity.index].generation == entity.generation;
+    }
+    int getEntityCount() const { return aliveCount; }
+
+    /**
+     * @brief Adds (or overwrites) component T of "entity"
+     *
+     * "entity" must be alive: a destroyed entity is a fatal error.
+     */
+    template<class T>
+    T& addComponent(Entity entity, const T &value = T()) {
+        const ComponentTypeId type = ComponentRegistry::typeOf<T>();
+        T *component = static_cast<T*>(addComponent(entity, type));
+        *component = value;
+        return *component;
+    }
+    /** Does nothing if "entity" is destroyed or hasn't T */
+    template<class T>
+    void removeComponent(Entity entity) { removeComponent(entity, ComponentRegistry::typeOf<T>()); }
+    /** false if "entity" is destroyed */
+    template<class T>
+    bool hasComponent(Entity entity) const {
+        return isAlive(entity) && records[entity.index].archetype->hasType(ComponentRegistry::typeOf<T>());
+    }
+    /** @return T* component T of "entity", nullptr if it hasn't one or is destroyed */
+    template<class T>
+    T* getComponent(Entity entity) {
+        if (!isAlive(entity))
+            return nullptr;
+        const ComponentTypeId type = ComponentRegistry::typeOf<T>();
+        const Record &record = records[entity.index];
+        if (!record.archetype->hasType(type))
+            return nullptr;
+        return static_cast<T*>(record.archetype->getComponent(record.row, type));
+    }
+
+    /**
+     * @brief Calls f(count, entities, Ts* components...) for every chunk
+     * whose entities have all the components Ts
+     */
+    template<class... Ts, class F>
+    void forEachChunk(F f) {
+        const ComponentMask required = maskOf<Ts...>();
+        for (size_t a = 0; a < archetypeList.size(); a++) {
+            Archetype &archetype = *archetypeList[a];
+            if ((archetype.getMask() & required) != required)
+                continue;
+            for (int chunk = 0; chunk < archetype.getChunkCount(); chunk++) {
+                const int count = archetype.getChunkEntityCount(chunk);
+                if (count > 0)
+                    f(count, static_cast<const Entity*>(archetype.getEntities(chunk)),
+                      archetype.template getComponents<Ts>(chunk)...);
+            }
+        }
+    }
+
+    /** @brief Calls f(entity, Ts& components...) for every matching entity */
+    template<class... Ts, class F>
+    void forEach(F f) {
+        typedef typename MakeIndices<sizeof...(Ts)>::type Sequence;
+        forEachChunk<Ts...>([&f](int count, const Entity *entities, Ts*... components) {
+            std::tuple<Ts*...> columns(components...);
+            for (int i = 0; i < count; i++)
+                World::callRow(f, entities[i], columns, i, Sequence());
+        });
+    }
+
+private:
+    World(const World&);
+    World& operator=(const World&);
+
+    struct Record {
+        Archetype *archetype;   // nullptr if the index is free
+        int row;
+        uint32_t generation;
+    };
+
+    template<int... Is> struct Indices {};
+    template<int N, int... Is> struct MakeIndices : MakeIndices<N - 1, N - 1, Is...> {};
+    template<int... Is> struct MakeIndices<0, Is...> { typedef Indices<Is...> type; };
+
+    template<class F, class... Ts, int... Is>
+    static void callRow(F &f, const Entity &entity, std::tuple<Ts*...> &columns, int row, Indices<Is...>) {
+        f(entity, std::get<Is>(columns)[row]...);
+    }
+
+    template<class... Ts>
+    static ComponentMask maskOf() {
+        ComponentMask mask = 0;
+        int expand[] = { 0, (mask |= ComponentRegistry::maskOf<Ts>(), 0)... };
+        (void) expand;
+        return mask;
+    }
+
+    void* addComponent(Entity entity, ComponentTypeId type);
+    void removeComponent(Entity entity, ComponentTypeId type);
+    Archetype* getArchetype(ComponentMask mask);
+    /** Moves "entity" to "target", updating the records */
+    void moveEntity(Entity entity, Archetype *target);
+
+    std::vector<Record> records;
+    std::vector<uint32_t> freeIndices;
+    int aliveCount;
+
+    std::unordered_map<ComponentMask, Archetype*> archetypes;
+    std::vector<std::unique_ptr<Archetype> > archetypeList;
+    Archetype *emptyArchetype;
+};
+
+}
+
+#endif // SM_WORLD_H
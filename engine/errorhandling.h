@@ -38,14 +38,14 @@ namespace sm {
     * @param line line from witch comes the error. Defaults to -1.
     * @return void
     */
-    void emitError(const char* message, const char* file = nullptr, int line = -1)
+    inline void emitError(const char* message, const char* file = nullptr, int line = -1)
     {
         if (file != nullptr && line != -1)
             std::cerr<<file<<':'<<line;
         
         std::cerr<<" SMEngine Error: "<<message<<std::endl;
     }
-    void emitError(const std::string &message, const char* file = nullptr, int line = -1){
+    inline void emitError(const std::string &message, const char* file = nullptr, int line = -1){
         emitError(message.data(),file,line);
     }
 
@@ -60,13 +60,13 @@ namespace sm {
     * @param line line from witch comes the error. Defaults to -1.
     * @return void
     */
-    void emitErrorFatal(const char* message, const int exit_number,const char* file = nullptr, int line = -1)
+    inline void emitErrorFatal(const char* message, const int exit_number,const char* file = nullptr, int line = -1)
     {
         emitError(message,file,line);
         SDL_Quit();
         exit(exit_number);
     }
-    void emitErrorFatal(const std::string &message, const int exit_number, const char* file = nullptr, int line = -1)
+    inline void emitErrorFatal(const std::string &message, const int exit_number, const char* file = nullptr, int line = -1)
     {
         emitErrorFatal(message.data(),exit_number,file,line);
     }
@@ -78,7 +78,7 @@ namespace sm {
     * @param msg error message
     * @return void
     */
-    void sdldie(const char *msg)
+    inline void sdldie(const char *msg)
     {
         std::stringstream message;
         message<<msg<<": "<<SDL_GetError();
@@ -86,7 +86,7 @@ namespace sm {
     }
 
     #define CheckSDLError() checkSDLError(__FILE__,__LINE__)
-    void checkSDLError(const char* file = nullptr,int line = -1)
+    inline void checkSDLError(const char* file = nullptr,int line = -1)
     /**
     * @brief Checks if there are SDL errores and prints them on STDERR.
     * 
@@ -22,19 +22,30 @@ using namespace sm;
 
 GeometryTransform::GeometryTransform()
 {
-    status_modified = true;
+    mModelView = nullptr;
+    mProjection = nullptr;
+    invalidate();
+}
+
+void GeometryTransform::invalidate()
+{
+    mvpModelViewGeneration = 0;
+    mvpProjectionGeneration = 0;
+    normalGeneration = 0;
+    normalNormalized = false;
+    inverseGeneration = 0;
 }
 
 void GeometryTransform::setModelViewMatrixStack(MatrixStack& mModelView)
 {
     this->mModelView = &mModelView;
-    status_modified = true;
+    invalidate();
 }
 
 void GeometryTransform::setProjectionMatrixStack(MatrixStack& mProjection)
 {
     this->mProjection = &mProjection;
-    status_modified = true;
+    invalidate();
 }
 
 void GeometryTransform::setMatrixStacks(MatrixStack& mModelView, MatrixStack& mProjection)
@@ -45,9 +56,11 @@ void GeometryTransform::setMatrixStacks(MatrixStack& mModelView, MatrixStack& mP
 
 const Matrix44& GeometryTransform::getModelViewProjectionMatrix()
 {
-    if (status_modified) {
+    if (mvpModelViewGeneration != mModelView->getGeneration()
+        || mvpProjectionGeneration != mProjection->getGeneration()) {
         mModelViewProjection = mProjection->getMatrix() * mModelView->getMatrix();
-        status_modified = false;
+        mvpModelViewGeneration = mModelView->getGeneration();
+        mvpProjectionGeneration = mProjection->getGeneration();
     }
     return mModelViewProjection;
 }
@@ -72,14 +85,29 @@ MatrixStack* GeometryTransform::getProjectionStack()
 
 const Matrix33& GeometryTransform::getNormalMatrix(bool bNormalize)
 {
-    if (status_modified) {
+    if (normalGeneration != mModelView->getGeneration() || normalNormalized != bNormalize) {
         mNormalMatrix = this->getModelViewMatrix().extractRotationMatrix();
 
         if(bNormalize)
             mNormalMatrix.normalize();
 
-        status_modified = false;
+        normalGeneration = mModelView->getGeneration();
+        normalNormalized = bNormalize;
     }
 
     return mNormalMatrix;
 }
+
+const Matrix44& GeometryTransform::getInverseModelViewMatrix()
+{
+    if (inverseGeneration != mModelView->getGeneration()) {
+        if (mModelView->getMatrixKind() == MATRIX_GENERAL)
+            mInverseModelView = this->getModelViewMatrix().inverse();
+        else
+            mInverseModelView = this->getModelViewMatrix().inverseAffine();
+
+        inverseGeneration = mModelView->getGeneration();
+    }
+
+    return mInverseModelView;
+}
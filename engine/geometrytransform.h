@@ -42,15 +42,25 @@ namespace sm {
         MatrixStack *getProjectionStack();
 
         const Matrix33& getNormalMatrix(bool bNormalize = false);
+        const Matrix44& getInverseModelViewMatrix();
 
     protected:
+        void invalidate();
+
         Matrix44       mModelViewProjection;
         Matrix33       mNormalMatrix;
+        Matrix44       mInverseModelView;
 
         MatrixStack* mModelView;
         MatrixStack* mProjection;
         
-        bool status_modified;
+        // generations of the stacks each cached matrix was computed from,
+        // 0 means never computed
+        unsigned long mvpModelViewGeneration;
+        unsigned long mvpProjectionGeneration;
+        unsigned long normalGeneration;
+        bool          normalNormalized;
+        unsigned long inverseGeneration;
     };
 }
 
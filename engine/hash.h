@@ -0,0 +1,67 @@
+/*
+    Example of the OpenGL usage with SDL2
+    Copyright (C) 2013  Matteo De Carlo <<matteo.dek@gmail.com>>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef SM_HASH_H
+#define SM_HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace sm {
+
+    typedef uint64_t smHash;
+
+    const smHash HASH_SEED = 14695981039346656037ULL;
+
+    /**
+    * @brief 64 bit FNV-1a hash of a block of memory.
+    *
+    * Not cryptographic, but stable across runs and platforms, so it can be
+    * used to build keys for on disk caches.
+    *
+    * @param data memory to hash
+    * @param size number of bytes
+    * @param seed previous hash value, to chain more blocks together
+    * @return sm::smHash the hash
+    */
+    inline smHash hashBytes(const void* data, size_t size, smHash seed = HASH_SEED)
+    {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        smHash hash = seed;
+        for (size_t i = 0; i < size; i++) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    /**
+    * @brief hashes a string, including its length so that consecutive
+    * strings chained together can't collide by moving characters around.
+    */
+    inline smHash hashString(const std::string &string, smHash seed = HASH_SEED)
+    {
+        uint64_t length = string.size();
+        seed = hashBytes(&length, sizeof(length), seed);
+        return hashBytes(string.data(), string.size(), seed);
+    }
+}
+
+#endif // SM_HASH_H
@@ -0,0 +1,274 @@
+/*
+ * Example of the OpenGL usage with SDL2
+ * Copyright (C) 2013 Matteo De Carlo <matteo.dek@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "jobsystem.h"
+#include "../errorhandling.h"
+#include <algorithm>
+#include <chrono>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using namespace sm;
+
+namespace sm {
+    struct Job {
+        JobSystem::JobFunction function;
+        JobCounter *counter;
+    };
+}
+
+namespace {
+    // index of the worker running on this thread, -1 outside the pool
+    thread_local int currentWorker = -1;
+    thread_local const void *currentSystem = nullptr;
+
+    const int SPIN_ROUNDS = 64;
+    const int CHUNKS_PER_THREAD = 4;
+}
+
+JobCounter::~JobCounter()
+{
+    // jobs whose dependency never reached 0
+    for (size_t i = 0; i < waiting.size(); i++)
+        delete waiting[i];
+}
+
+JobSystem::JobSystem(int workerCount, bool pinWorkers)
+    : sleepingCount(0), stopping(false), executedCount(0), stolenCount(0)
+{
+    if (workerCount < 0) {
+        workerCount = int(std::thread::hardware_concurrency()) - 1;
+        if (workerCount < 1)
+            workerCount = 1;
+    }
+
+    for (int i = 0; i < workerCount; i++)
+        workers.push_back(std::unique_ptr<Worker>(new Worker()));
+    // deques must all exist before any worker tries stealing
+    for (int i = 0; i < workerCount; i++)
+        workers[i]->thread = std::thread(&JobSystem::workerLoop, this, i, pinWorkers);
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    sleepCondition.notify_all();
+    for (size_t i = 0; i < workers.size(); i++)
+        workers[i]->thread.join();
+
+    // submitted from outside the pool after the workers stopped looking.
+    // Jobs still waiting on a dependency are parked in its JobCounter
+    for (size_t i = 0; i < sharedQueue.size(); i++)
+        delete sharedQueue[i];
+}
+
+void JobSystem::run(const JobFunction &function, JobCounter *counter, JobCounter *dependency)
+{
+    Job *job = new Job;
+    job->function = function;
+    job->counter = counter;
+    if (counter != nullptr)
+        counter->value.fetch_add(1, std::memory_order_relaxed);
+
+    if (dependency != nullptr && !dependency->isDone()) {
+        std::unique_lock<std::mutex> lock(dependency->waitingMutex);
+        // checked again under the lock, finish() empties the list under it
+        if (!dependency->isDone()) {
+            dependency->waiting.push_back(job);
+            return;
+        }
+    }
+    schedule(job);
+}
+
+void JobSystem::schedule(Job *job)
+{
+    if (currentSystem == this && currentWorker >= 0) {
+        workers[currentWorker]->deque.push(job);
+    } else {
+        std::lock_guard<std::mutex> lock(sharedMutex);
+        sharedQueue.push_back(job);
+    }
+
+    if (sleepingCount.load() > 0) {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        sleepCondition.notify_one();
+    }
+}
+
+Job* JobSystem::findJob(int self)
+{
+    if (self >= 0) {
+        Job *job = workers[self]->deque.pop();
+        if (job != nullptr)
+            return job;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(sharedMutex);
+        if (!sharedQueue.empty()) {
+            Job *job = sharedQueue.front();
+            sharedQueue.pop_front();
+            return job;
+        }
+    }
+
+    // steal, starting from the next worker so thieves spread out
+    const int count = int(workers.size());
+    for (int i = 1; i <= count; i++) {
+        const int victim = (self + i + count) % count;
+        if (victim == self)
+            continue;
+        Job *job = workers[victim]->deque.steal();
+        if (job != nullptr) {
+            stolenCount.fetch_add(1, std::memory_order_relaxed);
+            return job;
+        }
+    }
+    return nullptr;
+}
+
+void JobSystem::execute(Job *job)
+{
+    job->function();
+    JobCounter *counter = job->counter;
+    delete job;
+    executedCount.fetch_add(1, std::memory_order_relaxed);
+    if (counter != nullptr)
+        finish(counter);
+}
+
+void JobSystem::finish(JobCounter *counter)
+{
+    // decremented under the lock: once wait() got through the lock, nobody
+    // touches the counter anymore and its owner may destroy it
+    std::vector<Job*> released;
+    {
+        std::lock_guard<std::mutex> lock(counter->waitingMutex);
+        if (counter->value.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            released.swap(counter->waiting);
+    }
+    for (size_t i = 0; i < released.size(); i++)
+        schedule(released[i]);
+}
+
+void JobSystem::wait(JobCounter &counter)
+{
+    const int self = currentSystem == this ? currentWorker : -1;
+    int idleRounds = 0;
+    while (!counter.isDone()) {
+        Job *job = findJob(self);
+        if (job != nullptr) {
+            execute(job);
+            idleRounds = 0;
+        } else if (++idleRounds > SPIN_ROUNDS) {
+            std::this_thread::yield();
+        }
+    }
+
+    // wait for finish() to release the lock
+    std::lock_guard<std::mutex> lock(counter.waitingMutex);
+}
+
+void JobSystem::parallelFor(int begin, int end, const RangeFunction &body, int grain)
+{
+    const int count = end - begin;
+    if (count <= 0)
+        return;
+
+    if (grain <= 0) {
+        const int threads = getWorkerCount() + 1;
+        grain = count / (threads * CHUNKS_PER_THREAD);
+        if (grain < 1)
+            grain = 1;
+    }
+    if (count <= grain) {
+        body(begin, end);
+        return;
+    }
+
+    JobCounter counter;
+    // the calling thread takes the first chunk itself
+    for (int start = begin + grain; start < end; start += grain) {
+        const int stop = std::min(start + grain, end);
+        run([&body, start, stop]() { body(start, stop); }, &counter);
+    }
+    body(begin, begin + grain);
+    wait(counter);
+}
+
+JobSystem::ParallelFor JobSystem::getParallelFor()
+{
+    return [this](int begin, int end, const RangeFunction &body) { parallelFor(begin, end, body); };
+}
+
+void JobSystem::workerLoop(int index, bool pin)
+{
+    currentWorker = index;
+    currentSystem = this;
+
+#ifdef __linux__
+    if (pin) {
+        const int cores = int(std::thread::hardware_concurrency());
+        if (cores > 0) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            // core 0 is left to the main thread
+            CPU_SET((index + 1) % cores, &set);
+            if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+                emitError("could not pin job worker to its core");
+        }
+    }
+#else
+    (void) pin;
+#endif
+
+    int idleRounds = 0;
+    while (!stopping) {
+        Job *job = findJob(index);
+        if (job != nullptr) {
+            execute(job);
+            idleRounds = 0;
+            continue;
+        }
+
+        if (++idleRounds < SPIN_ROUNDS) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        // the timeout covers a job submitted between findJob() and the wait
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        sleepingCount++;
+        if (!stopping)
+            sleepCondition.wait_for(lock, std::chrono::milliseconds(1));
+        sleepingCount--;
+        idleRounds = 0;
+    }
+
+    // finish the local jobs, nobody else may take them after we exit
+    Job *job;
+    while ((job = workers[index]->deque.pop()) != nullptr)
+        execute(job);
+}
@@ -0,0 +1,156 @@
+/*
+ * Example of the OpenGL usage with SDL2
+ * Copyright (C) 2013 Matteo De Carlo <matteo.dek@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef SM_JOBSYSTEM_H
+#define SM_JOBSYSTEM_H
+
+#include "workstealingdeque.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sm {
+
+struct Job;
+
+/**
+ * @brief Counts the unfinished jobs of a group
+ *
+ * Incremented when a job is submitted with it, decremented when the job
+ * ends. Jobs may wait for a counter to reach zero before starting, see
+ * JobSystem::run(). A counter must not be destroyed, nor reused, while
+ * jobs refer to it.
+ *
+ * Jobs waiting on a counter are held by it, not by the JobSystem: they are
+ * deleted, without running, if the counter is destroyed before reaching 0.
+ */
+class JobCounter
+{
+    friend class JobSystem;
+public:
+    JobCounter() : value(0) {}
+    ~JobCounter();
+    bool isDone() const { return value.load(std::memory_order_acquire) == 0; }
+
+private:
+    JobCounter(const JobCounter&);
+    JobCounter& operator=(const JobCounter&);
+
+    std::atomic<int> value;
+    std::mutex waitingMutex;
+    std::vector<Job*> waiting;  // jobs started when value reaches 0
+};
+
+/**
+ * @brief Pool of worker threads running small jobs
+ *
+ * Every worker owns a WorkStealingDeque: the jobs it submits go to its own
+ * deque and are run LIFO, cache warm, while idle workers steal the oldest
+ * jobs of the others. Jobs submitted by other threads (the main thread) go
+ * to a shared queue. A thread waiting on a JobCounter runs jobs meanwhile,
+ * so waiting inside a job doesn't deadlock the pool.
+ */
+class JobSystem
+{
+public:
+    typedef std::function<void()> JobFunction;
+    typedef std::function<void(int begin, int end)> RangeFunction;
+    /** Same signature as TransformHierarchy::ParallelFor */
+    typedef std::function<void(int begin, int end, const RangeFunction &body)> ParallelFor;
+
+    /**
+     * @param workerCount threads to start, -1 for one per core but one (the
+     * calling thread works too while waiting)
+     * @param pinWorkers pin worker "i" to core "i + 1" (Linux only)
+     */
+    explicit JobSystem(int workerCount = -1, bool pinWorkers = false);
+    ~JobSystem();
+
+    int getWorkerCount() const { return int(workers.size()); }
+
+    /**
+     * @brief Runs "job" on some worker
+     *
+     * @param counter if not null, incremented now and decremented when the
+     * job ends
+     * @param dependency if not null, the job starts only once it reaches 0.
+     * Until then the job is parked in "dependency", which must reach 0
+     * before the JobSystem is destroyed for the job to run at all
+     */
+    void run(const JobFunction &job, JobCounter *counter = nullptr, JobCounter *dependency = nullptr);
+
+    /** Runs jobs until "counter" reaches 0 */
+    void wait(JobCounter &counter);
+
+    /**
+     * @brief Calls body(rangeBegin, rangeEnd) over [begin, end) split in
+     * chunks of "grain" items, and waits for all of them
+     *
+     * @param grain 0 picks a grain giving a few chunks per thread, enough
+     * for stealing to even out uneven chunks
+     */
+    void parallelFor(int begin, int end, const RangeFunction &body, int grain = 0);
+
+    /** parallelFor() with automatic grain as a ParallelFor callback */
+    ParallelFor getParallelFor();
+
+    /** Jobs executed, and how many of them were stolen, since construction */
+    long getExecutedCount() const { return executedCount; }
+    long getStolenCount() const { return stolenCount; }
+
+private:
+    JobSystem(const JobSystem&);
+    JobSystem& operator=(const JobSystem&);
+
+    struct Worker {
+        Worker() : deque(256) {}
+        WorkStealingDeque<Job> deque;
+        std::thread thread;
+    };
+
+    void workerLoop(int index, bool pin);
+    /** Queues a job whose dependency is satisfied */
+    void schedule(Job *job);
+    /** Takes a job from anywhere, nullptr if none found */
+    Job* findJob(int self);
+    void execute(Job *job);
+    void finish(JobCounter *counter);
+
+    std::vector<std::unique_ptr<Worker> > workers;
+
+    std::mutex sharedMutex;
+    std::deque<Job*> sharedQueue;   // jobs submitted from outside the pool
+
+    std::mutex sleepMutex;
+    std::condition_variable sleepCondition;
+    std::atomic<int> sleepingCount;
+    std::atomic<bool> stopping;
+
+    std::atomic<long> executedCount;
+    std::atomic<long> stolenCount;
+};
+
+}
+
+#endif // SM_JOBSYSTEM_H
@@ -0,0 +1,146 @@
+/*
+ * Example of the OpenGL usage with SDL2
+ * Copyright (C) 2013 Matteo De Carlo <matteo.dek@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef SM_WORKSTEALINGDEQUE_H
+#define SM_WORKSTEALINGDEQUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace sm {
+
+/**
+ * @brief Chase-Lev work stealing deque of pointers
+ *
+ * The owner thread push()es and pop()s at the bottom, LIFO, other threads
+ * steal() from the top, FIFO. Only steal() may be called concurrently by
+ * other threads. The buffer grows when full; old buffers are kept until the
+ * deque is destroyed, since a thief may still be reading them.
+ *
+ * Memory orderings follow Lê, Pop, Cohen, Zappa Nardelli, "Correct and
+ * Efficient Work-Stealing for Weak Memory Models" (PPoPP 2013).
+ */
+template<class T>
+class WorkStealingDeque
+{
+public:
+    explicit WorkStealingDeque(int initialCapacity = 1024)
+        : top(0), bottom(0)
+    {
+        int capacity = 1;
+        while (capacity < initialCapacity)
+            capacity <<= 1;
+        buffers.push_back(new Buffer(capacity));
+        buffer.store(buffers.back(), std::memory_order_relaxed);
+    }
+
+    ~WorkStealingDeque() {
+        for (size_t i = 0; i < buffers.size(); i++)
+            delete buffers[i];
+    }
+
+    /** Owner only */
+    void push(T *item) {
+        const long b = bottom.load(std::memory_order_relaxed);
+        const long t = top.load(std::memory_order_acquire);
+        Buffer *current = buffer.load(std::memory_order_relaxed);
+        if (b - t > current->mask) {
+            current = grow(current, t, b);
+        }
+        current->put(b, item);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom.store(b + 1, std::memory_order_relaxed);
+    }
+
+    /** Owner only. @return T* nullptr if empty */
+    T* pop() {
+        const long b = bottom.load(std::memory_order_relaxed) - 1;
+        Buffer *current = buffer.load(std::memory_order_relaxed);
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        long t = top.load(std::memory_order_relaxed);
+
+        if (t > b) {
+            // empty
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        T *item = current->get(b);
+        if (t == b) {
+            // last item, race against the thieves
+            if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                item = nullptr;
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return item;
+    }
+
+    /** Any thread. @return T* nullptr if empty or if another thread won the race */
+    T* steal() {
+        long t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const long b = bottom.load(std::memory_order_acquire);
+        if (t >= b)
+            return nullptr;
+
+        Buffer *current = buffer.load(std::memory_order_acquire);
+        T *item = current->get(t);
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            return nullptr;
+        return item;
+    }
+
+    /** Approximate, for heuristics only */
+    bool empty() const {
+        return bottom.load(std::memory_order_relaxed) <= top.load(std::memory_order_relaxed);
+    }
+
+private:
+    WorkStealingDeque(const WorkStealingDeque&);
+    WorkStealingDeque& operator=(const WorkStealingDeque&);
+
+    struct Buffer {
+        explicit Buffer(int capacity) : mask(capacity - 1), items(new std::atomic<T*>[capacity]) {}
+        ~Buffer() { delete[] items; }
+        T* get(long i) const { return items[i & mask].load(std::memory_order_relaxed); }
+        void put(long i, T *item) { items[i & mask].store(item, std::memory_order_relaxed); }
+        long mask;
+        std::atomic<T*> *items;
+    };
+
+    Buffer* grow(Buffer *current, long t, long b) {
+        Buffer *bigger = new Buffer(int(current->mask + 1) * 2);
+        for (long i = t; i < b; i++)
+            bigger->put(i, current->get(i));
+        buffers.push_back(bigger);
+        buffer.store(bigger, std::memory_order_release);
+        return bigger;
+    }
+
+    std::atomic<long> top;
+    std::atomic<long> bottom;
+    std::atomic<Buffer*> buffer;
+    std::vector<Buffer*> buffers;   // owner only
+};
+
+}
+
+#endif // SM_WORKSTEALINGDEQUE_H
@@ -25,6 +25,26 @@ Frustum::Frustum()
 {
 }
 
+void Frustum::extractPlanes(const Matrix44 &viewProjection, Vector4 planes[PLANE_COUNT])
+{
+    const smReal *m = viewProjection.data();
+
+    // row "i" of the column major matrix is (m[i], m[4+i], m[8+i], m[12+i])
+    for (int i = 0; i < 3; i++) {
+        for (int c = 0; c < 4; c++) {
+            planes[i*2][c]   = m[c*4+3] + m[c*4+i];
+            planes[i*2+1][c] = m[c*4+3] - m[c*4+i];
+        }
+    }
+
+    for (int p = 0; p < PLANE_COUNT; p++) {
+        Vector4 &plane = planes[p];
+        smReal length = std::sqrt(plane[0]*plane[0] + plane[1]*plane[1] + plane[2]*plane[2]);
+        if (length > 0.0f)
+            plane.scale(1.0f / length);
+    }
+}
+
 void Frustum::init()
 {
     this->setOrthographic(-1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f);
@@ -27,9 +27,29 @@ namespace sm {
     class Frustum
     {
     public:
+        /** Order of the planes filled by extractPlanes() */
+        enum PLANE {
+            PLANE_LEFT   = 0,
+            PLANE_RIGHT  = 1,
+            PLANE_BOTTOM = 2,
+            PLANE_TOP    = 3,
+            PLANE_NEAR   = 4,
+            PLANE_FAR    = 5,
+            PLANE_COUNT  = 6
+        };
+
         explicit Frustum();
         void init();
 
+        /**
+         * @brief Extracts the 6 clipping planes of a (view-)projection matrix
+         *
+         * Each plane is (a, b, c, d) with a normalized normal pointing inside:
+         * a point p is inside if a*p.x + b*p.y + c*p.z + d >= 0. With a
+         * view-projection matrix the planes are in world space.
+         */
+        static void extractPlanes(const Matrix44 &viewProjection, Vector4 planes[PLANE_COUNT]);
+
         const Matrix44& GetProjectionMatrix() { return projMatrix; }
         void setOrthographic(smReal xMin, smReal xMax, smReal yMin, smReal yMax, smReal zMin, smReal zMax);
         void setPerspective(smReal fFov, smReal fAspect, smReal fNear, smReal fFar);
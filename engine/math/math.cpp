@@ -77,7 +77,76 @@ Matrix44& Matrix44::operator*=(const Matrix44& right)
     return *this;
 }
 
-void Matrix44::loadRotationMatrix(const smReal angle, const Vector3 &axis)
+Matrix44 Matrix44::multiplyAffine(const Matrix44& right) const
+{
+#define A(row,col)  a[(col<<2)+row]
+#define B(row,col)  b[(col<<2)+row]
+#define P(row,col)  result[(col<<2)+row]
+
+    const int_matrix &a = this->matrix;
+    const int_matrix &b = right.matrix;
+    int_matrix result;
+
+    // B(3,0..2) are 0 and B(3,3) is 1
+    for (int i = 0; i < 3; i++) {
+        smReal ai0=A(i,0),  ai1=A(i,1),  ai2=A(i,2);
+        P(i,0) = ai0 * B(0,0) + ai1 * B(1,0) + ai2 * B(2,0);
+        P(i,1) = ai0 * B(0,1) + ai1 * B(1,1) + ai2 * B(2,1);
+        P(i,2) = ai0 * B(0,2) + ai1 * B(1,2) + ai2 * B(2,2);
+        P(i,3) = ai0 * B(0,3) + ai1 * B(1,3) + ai2 * B(2,3) + A(i,3);
+    }
+    P(3,0) = 0.0f;
+    P(3,1) = 0.0f;
+    P(3,2) = 0.0f;
+    P(3,3) = 1.0f;
+
+    return Matrix44(result);
+
+#undef A
+#undef B
+#undef P
+}
+
+MatrixKind Matrix44::classify() const
+{
+    const int_matrix &m = this->matrix;
+    if (m[3] != 0.0f || m[7] != 0.0f || m[11] != 0.0f || m[15] != 1.0f)
+        return MATRIX_GENERAL;
+    if (m[0] != 1.0f || m[1] != 0.0f || m[2] != 0.0f ||
+        m[4] != 0.0f || m[5] != 1.0f || m[6] != 0.0f ||
+        m[8] != 0.0f || m[9] != 0.0f || m[10] != 1.0f)
+        return MATRIX_AFFINE;
+    if (m[12] != 0.0f || m[13] != 0.0f || m[14] != 0.0f)
+        return MATRIX_TRANSLATION;
+    return MATRIX_IDENTITY;
+}
+
+void Matrix44::translate(const Vector3 &translation)
+{
+    const smReal x = translation.get(0);
+    const smReal y = translation.get(1);
+    const smReal z = translation.get(2);
+
+    for (int row = 0; row < 4; row++)
+        matrix[12+row] += matrix[row] * x + matrix[4+row] * y + matrix[8+row] * z;
+}
+
+void Matrix44::scale(const Vector3 &scale)
+{
+    for (int col = 0; col < 3; col++) {
+        const smReal s = scale.get(col);
+        matrix[col*4+0] *= s;
+        matrix[col*4+1] *= s;
+        matrix[col*4+2] *= s;
+        matrix[col*4+3] *= s;
+    }
+}
+
+/**
+ * Upper 3x3 part of the rotation matrix of "angle" radiants around "axis",
+ * column major. Returns false if the axis is null.
+ */
+static bool rotationCoefficients(const smReal angle, const Vector3 &axis, smReal r[9])
 {
     smReal mag, s, c;
     smReal xx, yy, zz, xy, yz, zx, xs, ys, zs, one_c;
@@ -90,21 +159,16 @@ void Matrix44::loadRotationMatrix(const smReal angle, const Vector3 &axis)
     s = smReal(sin(angle));
     c = smReal(cos(angle));
 
-    mag = t_axis.leghtSquared();
+    mag = t_axis.lenght();
 
-    // Identity matrix
-    if (mag == 0.0f) {
-        this->loadIdentity();
-        return;
-    }
+    if (mag == 0.0f)
+        return false;
 
     // Rotation matrix is normalized
     x /= mag;
     y /= mag;
     z /= mag;
 
-#define M(row,col)  this->matrix[col*4+row]
-
     xx = x * x;
     yy = y * y;
     zz = z * z;
@@ -116,19 +180,65 @@ void Matrix44::loadRotationMatrix(const smReal angle, const Vector3 &axis)
     zs = z * s;
     one_c = 1.0f - c;
 
-    M(0,0) = (one_c * xx) + c;
-    M(0,1) = (one_c * xy) - zs;
-    M(0,2) = (one_c * zx) + ys;
+#define R(row,col)  r[col*3+row]
+    R(0,0) = (one_c * xx) + c;
+    R(0,1) = (one_c * xy) - zs;
+    R(0,2) = (one_c * zx) + ys;
+
+    R(1,0) = (one_c * xy) + zs;
+    R(1,1) = (one_c * yy) + c;
+    R(1,2) = (one_c * yz) - xs;
+
+    R(2,0) = (one_c * zx) - ys;
+    R(2,1) = (one_c * yz) + xs;
+    R(2,2) = (one_c * zz) + c;
+#undef R
+
+    return true;
+}
+
+void Matrix44::rotate(const smReal angle, const Vector3 &axis, bool affine)
+{
+    smReal r[9];
+    if (!rotationCoefficients(angle, axis, r))
+        return;
+
+    // new column j = sum over k of old column k * R(k,j)
+    const int rows = affine ? 3 : 4;
+    for (int row = 0; row < rows; row++) {
+        const smReal m0 = matrix[row], m1 = matrix[4+row], m2 = matrix[8+row];
+        matrix[row]   = m0 * r[0] + m1 * r[1] + m2 * r[2];
+        matrix[4+row] = m0 * r[3] + m1 * r[4] + m2 * r[5];
+        matrix[8+row] = m0 * r[6] + m1 * r[7] + m2 * r[8];
+    }
+}
+
+void Matrix44::loadRotationMatrix(const smReal angle, const Vector3 &axis)
+{
+    smReal r[9];
+
+    // Identity matrix
+    if (!rotationCoefficients(angle, axis, r)) {
+        this->loadIdentity();
+        return;
+    }
+
+#define M(row,col)  this->matrix[col*4+row]
+#define R(row,col)  r[col*3+row]
+
+    M(0,0) = R(0,0);
+    M(0,1) = R(0,1);
+    M(0,2) = R(0,2);
     M(0,3) = 0.0f;
 
-    M(1,0) = (one_c * xy) + zs;
-    M(1,1) = (one_c * yy) + c;
-    M(1,2) = (one_c * yz) - xs;
+    M(1,0) = R(1,0);
+    M(1,1) = R(1,1);
+    M(1,2) = R(1,2);
     M(1,3) = 0.0f;
 
-    M(2,0) = (one_c * zx) - ys;
-    M(2,1) = (one_c * yz) + xs;
-    M(2,2) = (one_c * zz) + c;
+    M(2,0) = R(2,0);
+    M(2,1) = R(2,1);
+    M(2,2) = R(2,2);
     M(2,3) = 0.0f;
 
     M(3,0) = 0.0f;
@@ -136,6 +246,7 @@ void Matrix44::loadRotationMatrix(const smReal angle, const Vector3 &axis)
     M(3,2) = 0.0f;
     M(3,3) = 1.0f;
 
+#undef R
 #undef M
 }
 
@@ -145,6 +256,7 @@ void Matrix44::loadScaleMatrix(const Vector3 &scale)
     matrix[0] = scale.get(0);
     matrix[5] = scale.get(1);
     matrix[10] = scale.get(2);
+    matrix[15] = 1.0f;
 }
 
 void Matrix44::loadTranslationMatrix(const Vector3 &translation)
@@ -180,6 +292,91 @@ Matrix33 Matrix44::extractRotationMatrix() const
     return Matrix33(dst);
 }
 
+Matrix44 Matrix44::inverse() const
+{
+    const int_matrix &m = this->matrix;
+    int_matrix inv;
+
+    inv[0]  =  m[5]*m[10]*m[15] - m[5]*m[11]*m[14] - m[9]*m[6]*m[15] + m[9]*m[7]*m[14] + m[13]*m[6]*m[11] - m[13]*m[7]*m[10];
+    inv[4]  = -m[4]*m[10]*m[15] + m[4]*m[11]*m[14] + m[8]*m[6]*m[15] - m[8]*m[7]*m[14] - m[12]*m[6]*m[11] + m[12]*m[7]*m[10];
+    inv[8]  =  m[4]*m[9]*m[15]  - m[4]*m[11]*m[13] - m[8]*m[5]*m[15] + m[8]*m[7]*m[13] + m[12]*m[5]*m[11] - m[12]*m[7]*m[9];
+    inv[12] = -m[4]*m[9]*m[14]  + m[4]*m[10]*m[13] + m[8]*m[5]*m[14] - m[8]*m[6]*m[13] - m[12]*m[5]*m[10] + m[12]*m[6]*m[9];
+    inv[1]  = -m[1]*m[10]*m[15] + m[1]*m[11]*m[14] + m[9]*m[2]*m[15] - m[9]*m[3]*m[14] - m[13]*m[2]*m[11] + m[13]*m[3]*m[10];
+    inv[5]  =  m[0]*m[10]*m[15] - m[0]*m[11]*m[14] - m[8]*m[2]*m[15] + m[8]*m[3]*m[14] + m[12]*m[2]*m[11] - m[12]*m[3]*m[10];
+    inv[9]  = -m[0]*m[9]*m[15]  + m[0]*m[11]*m[13] + m[8]*m[1]*m[15] - m[8]*m[3]*m[13] - m[12]*m[1]*m[11] + m[12]*m[3]*m[9];
+    inv[13] =  m[0]*m[9]*m[14]  - m[0]*m[10]*m[13] - m[8]*m[1]*m[14] + m[8]*m[2]*m[13] + m[12]*m[1]*m[10] - m[12]*m[2]*m[9];
+    inv[2]  =  m[1]*m[6]*m[15]  - m[1]*m[7]*m[14]  - m[5]*m[2]*m[15] + m[5]*m[3]*m[14] + m[13]*m[2]*m[7]  - m[13]*m[3]*m[6];
+    inv[6]  = -m[0]*m[6]*m[15]  + m[0]*m[7]*m[14]  + m[4]*m[2]*m[15] - m[4]*m[3]*m[14] - m[12]*m[2]*m[7]  + m[12]*m[3]*m[6];
+    inv[10] =  m[0]*m[5]*m[15]  - m[0]*m[7]*m[13]  - m[4]*m[1]*m[15] + m[4]*m[3]*m[13] + m[12]*m[1]*m[7]  - m[12]*m[3]*m[5];
+    inv[14] = -m[0]*m[5]*m[14]  + m[0]*m[6]*m[13]  + m[4]*m[1]*m[14] - m[4]*m[2]*m[13] - m[12]*m[1]*m[6]  + m[12]*m[2]*m[5];
+    inv[3]  = -m[1]*m[6]*m[11]  + m[1]*m[7]*m[10]  + m[5]*m[2]*m[11] - m[5]*m[3]*m[10] - m[9]*m[2]*m[7]   + m[9]*m[3]*m[6];
+    inv[7]  =  m[0]*m[6]*m[11]  - m[0]*m[7]*m[10]  - m[4]*m[2]*m[11] + m[4]*m[3]*m[10] + m[8]*m[2]*m[7]   - m[8]*m[3]*m[6];
+    inv[11] = -m[0]*m[5]*m[11]  + m[0]*m[7]*m[9]   + m[4]*m[1]*m[11] - m[4]*m[3]*m[9]  - m[8]*m[1]*m[7]   + m[8]*m[3]*m[5];
+    inv[15] =  m[0]*m[5]*m[10]  - m[0]*m[6]*m[9]   - m[4]*m[1]*m[10] + m[4]*m[2]*m[9]  + m[8]*m[1]*m[6]   - m[8]*m[2]*m[5];
+
+    smReal det = m[0]*inv[0] + m[1]*inv[4] + m[2]*inv[8] + m[3]*inv[12];
+    if (det == 0.0f) {
+        static const int_matrix identity = { 1, 0, 0, 0,
+                                             0, 1, 0, 0,
+                                             0, 0, 1, 0,
+                                             0, 0, 0, 1 };
+        return Matrix44(identity);
+    }
+
+    det = 1.0f / det;
+    for (int i = 0; i < 16; i++)
+        inv[i] *= det;
+
+    return Matrix44(inv);
+}
+
+Matrix44 Matrix44::inverseAffine() const
+{
+#define M(row,col)  m[(col<<2)+row]
+#define I(row,col)  inv[(col<<2)+row]
+
+    const int_matrix &m = this->matrix;
+    int_matrix inv;
+
+    // inverse of the 3x3 part through its cofactors
+    smReal c00 = M(1,1)*M(2,2) - M(1,2)*M(2,1);
+    smReal c01 = M(1,2)*M(2,0) - M(1,0)*M(2,2);
+    smReal c02 = M(1,0)*M(2,1) - M(1,1)*M(2,0);
+    smReal det = M(0,0)*c00 + M(0,1)*c01 + M(0,2)*c02;
+    if (det == 0.0f) {
+        static const int_matrix identity = { 1, 0, 0, 0,
+                                             0, 1, 0, 0,
+                                             0, 0, 1, 0,
+                                             0, 0, 0, 1 };
+        return Matrix44(identity);
+    }
+    smReal invDet = 1.0f / det;
+
+    I(0,0) = c00 * invDet;
+    I(1,0) = c01 * invDet;
+    I(2,0) = c02 * invDet;
+    I(0,1) = (M(0,2)*M(2,1) - M(0,1)*M(2,2)) * invDet;
+    I(1,1) = (M(0,0)*M(2,2) - M(0,2)*M(2,0)) * invDet;
+    I(2,1) = (M(0,1)*M(2,0) - M(0,0)*M(2,1)) * invDet;
+    I(0,2) = (M(0,1)*M(1,2) - M(0,2)*M(1,1)) * invDet;
+    I(1,2) = (M(0,2)*M(1,0) - M(0,0)*M(1,2)) * invDet;
+    I(2,2) = (M(0,0)*M(1,1) - M(0,1)*M(1,0)) * invDet;
+
+    // translation is -inverse(3x3) * t
+    for (int row = 0; row < 3; row++)
+        I(row,3) = -(I(row,0)*M(0,3) + I(row,1)*M(1,3) + I(row,2)*M(2,3));
+
+    I(3,0) = 0.0f;
+    I(3,1) = 0.0f;
+    I(3,2) = 0.0f;
+    I(3,3) = 1.0f;
+
+    return Matrix44(inv);
+
+#undef M
+#undef I
+}
+
 void Matrix33::normalize()
 {
     //TODO optimize this code
@@ -27,6 +27,18 @@ namespace sm {
 class Vector3;
 class Matrix33;
 
+/**
+ * @brief Shape of a 4x4 matrix, from the cheapest to the most general.
+ *
+ * Knowing it lets multiplications skip the work on the known rows/columns.
+ */
+enum MatrixKind {
+    MATRIX_IDENTITY    = 0, // identity
+    MATRIX_TRANSLATION = 1, // identity 3x3 part, only column 3 is meaningful
+    MATRIX_AFFINE      = 2, // last row is (0, 0, 0, 1)
+    MATRIX_GENERAL     = 3  // anything, e.g. projections
+};
+
 class Matrix44 {
 private:
     typedef smReal int_matrix[4*4];
@@ -107,6 +119,39 @@ public:
     
     Matrix44& operator*=(const Matrix44 &right);
     
+    /**
+     * @brief Same as operator*, but both matrices must be affine (last row
+     * 0, 0, 0, 1). Skips the computation of the last row.
+     */
+    Matrix44 multiplyAffine(const Matrix44& right) const;
+    
+    /**
+     * @brief Finds the cheapest MatrixKind describing this matrix
+     */
+    MatrixKind classify() const;
+    
+    /**
+     * @brief In place this = this * translation(translation)
+     * 
+     * Only column 3 is modified.
+     */
+    void translate(const Vector3 &translation);
+    
+    /**
+     * @brief In place this = this * scale(scale)
+     * 
+     * Only multiplies the first three columns.
+     */
+    void scale(const Vector3 &scale);
+    
+    /**
+     * @brief In place this = this * rotation(radiants, axis)
+     * 
+     * Column 3 is left untouched. If "affine" is true the last row is
+     * assumed to be (0, 0, 0, 1) and not computed.
+     */
+    void rotate(const smReal radiants, const Vector3 &axis, bool affine = false);
+    
     smReal& operator[](int pos) {
         return matrix[pos];
     }
@@ -122,6 +167,19 @@ public:
     
     Matrix33 extractRotationMatrix() const;
     
+    /**
+     * @brief Inverse of the matrix, in a new Matrix.
+     * 
+     * If the matrix is singular the identity is returned.
+     */
+    Matrix44 inverse() const;
+    
+    /**
+     * @brief Inverse of an affine matrix (last row 0, 0, 0, 1), cheaper
+     * than inverse().
+     */
+    Matrix44 inverseAffine() const;
+    
     const smReal* data() const
     {
         return matrix;
@@ -148,6 +148,11 @@ public:
     smReal get(const int pos) const{
         return coordinates[pos];
     }
+    
+    const smReal* data() const
+    {
+        return coordinates;
+    }
   
 private:
     typedef smReal int_vector[3];
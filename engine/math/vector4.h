@@ -57,6 +57,10 @@ public:
         coordinates[3] = w;
     }
     
+    inline Vector4(const Vector4& original) {
+        this->copyFrom(original);
+    }
+    
     /**
      * @brief Create a new 4D vector with values copyed from the vector passed
      * 
@@ -143,6 +147,16 @@ public:
         return coordinates[pos];
     }
     
+    smReal get(const int pos) const
+    {
+        return coordinates[pos];
+    }
+    
+    const smReal* data() const
+    {
+        return coordinates;
+    }
+    
 private:
     typedef smReal int_vector[4];
     int_vector coordinates;
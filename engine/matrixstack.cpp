@@ -37,12 +37,19 @@ MatrixStack::MatrixStack(int stackDepth)
     this->stackDepth = stackDepth;
     this->stackPointer = 0;
     this->pStack = new Matrix44[stackDepth];
+    this->pKind = new MatrixKind[stackDepth];
+    this->pGeneration = new unsigned long[stackDepth];
+    this->lastGeneration = 0;
     pStack[0].loadIdentity();
+    pKind[0] = MATRIX_IDENTITY;
+    touch();
 }
 
 MatrixStack::~MatrixStack()
 {
     delete [] pStack;
+    delete [] pKind;
+    delete [] pGeneration;
 }
 
 void MatrixStack::PushMatrix()
@@ -57,50 +64,124 @@ void MatrixStack::PushMatrix()
     }
 
     pStack[stackPointer].copyFrom(pStack[stackPointer-1]);
+    pKind[stackPointer] = pKind[stackPointer-1];
+    // same content, same generation
+    pGeneration[stackPointer] = pGeneration[stackPointer-1];
 }
 
 void MatrixStack::PopMatrix()
 {
     this->stackPointer--;
-    if (stackPointer < 0)
+    if (stackPointer < 0) {
         emitError("matrix stack empty! Couldn't pop from it any more");
+        stackPointer = 0;
+    }
 }
 
 void MatrixStack::loadIdentity()
 {
     pStack[stackPointer].loadIdentity();
+    pKind[stackPointer] = MATRIX_IDENTITY;
+    touch();
 }
 
 void MatrixStack::loadMatrix(const Matrix44 &matrix)
 {
     pStack[stackPointer].copyFrom(matrix);
+    pKind[stackPointer] = matrix.classify();
+    touch();
 }
 
 void MatrixStack::scale(const Vector3 vScale)
 {
-    Matrix44 mScale;
-    mScale.loadScaleMatrix(vScale);
-    pStack[stackPointer] = pStack[stackPointer] * mScale;
+    pStack[stackPointer].scale(vScale);
+    if (pKind[stackPointer] < MATRIX_AFFINE)
+        pKind[stackPointer] = MATRIX_AFFINE;
+    touch();
 }
 
 void MatrixStack::translate(const Vector3 vTranslate)
 {
-    Matrix44 mTranslate;
-    mTranslate.loadTranslationMatrix(vTranslate);
-    pStack[stackPointer] = pStack[stackPointer] * mTranslate;
+    Matrix44 &top = pStack[stackPointer];
+
+    switch (pKind[stackPointer]) {
+    case MATRIX_IDENTITY:
+    case MATRIX_TRANSLATION:
+        // the 3x3 part is the identity: just add the offset
+        top[12] += vTranslate.get(0);
+        top[13] += vTranslate.get(1);
+        top[14] += vTranslate.get(2);
+        pKind[stackPointer] = MATRIX_TRANSLATION;
+        break;
+    default:
+        top.translate(vTranslate);
+        break;
+    }
+    touch();
 }
 
 
 void MatrixStack::rotate(GLfloat rad, Vector3 vAxis)
 {
-    Matrix44 mRotation;
-    mRotation.loadRotationMatrix(rad,vAxis);
-    pStack[stackPointer] = pStack[stackPointer] * mRotation;
+    Matrix44 &top = pStack[stackPointer];
+
+    switch (pKind[stackPointer]) {
+    case MATRIX_IDENTITY:
+    case MATRIX_TRANSLATION: {
+        // rotation goes straight in the 3x3 part, the translation stays
+        const smReal x = top[12], y = top[13], z = top[14];
+        top.loadRotationMatrix(rad, vAxis);
+        top[12] = x;
+        top[13] = y;
+        top[14] = z;
+        pKind[stackPointer] = MATRIX_AFFINE;
+        break;
+    }
+    case MATRIX_AFFINE:
+        top.rotate(rad, vAxis, true);
+        break;
+    default:
+        top.rotate(rad, vAxis);
+        break;
+    }
+    touch();
+}
+
+void MatrixStack::multiply(const Matrix44 &matrix, MatrixKind kind)
+{
+    Matrix44 &top = pStack[stackPointer];
+    MatrixKind &topKind = pKind[stackPointer];
+
+    if (kind == MATRIX_IDENTITY)
+        return;
+    touch();
+
+    switch (topKind) {
+    case MATRIX_IDENTITY:
+        top.copyFrom(matrix);
+        topKind = kind;
+        return;
+    case MATRIX_TRANSLATION:
+    case MATRIX_AFFINE:
+        if (kind == MATRIX_TRANSLATION) {
+            top.translate(Vector3(matrix.data()[12], matrix.data()[13], matrix.data()[14]));
+        } else if (kind == MATRIX_AFFINE) {
+            top = top.multiplyAffine(matrix);
+            topKind = MATRIX_AFFINE;
+        } else {
+            top *= matrix;
+            topKind = MATRIX_GENERAL;
+        }
+        return;
+    default:
+        top *= matrix;
+        return;
+    }
 }
 
 MatrixStack& MatrixStack::operator*=(const Matrix44& matrix)
 {
-    pStack[stackPointer] *= matrix;
+    this->multiply(matrix, matrix.classify());
     return *this;
 }
 
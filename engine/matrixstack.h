@@ -42,6 +42,11 @@ public:
         loadMatrix(frame.getCameraMatrix());
         }
     MatrixStack& operator*=(const Matrix44 &matrix);
+    /**
+     * @brief multiplies the top of the stack with "matrix", whose shape is
+     * already known to the caller, so that it doesn't need to be classified.
+     */
+    void multiply(const Matrix44 &matrix, MatrixKind kind);
 
     void scale(const sm::Vector3 vScale);
     void translate(const Vector3);
@@ -49,11 +54,30 @@ public:
 
     const Matrix44& getMatrix() const { return pStack[stackPointer]; }
     void getMatrix(Matrix44 mMatrix) { mMatrix.copyFrom(pStack[stackPointer]); }    
+    /** shape of the matrix on top of the stack */
+    MatrixKind getMatrixKind() const { return pKind[stackPointer]; }
+    
+    /**
+     * @brief generation of the matrix on top of the stack
+     * 
+     * Every change of the top matrix (load, multiply, transform) gives it a
+     * new, bigger, generation, so anything derived from the matrix can be
+     * cached and recomputed only if the generation changed. pop() doesn't
+     * issue a new one: it restores the generation saved with the matrix
+     * below, which is still the same matrix. Generations start from 1 and
+     * are unique only within this stack.
+     */
+    unsigned long getGeneration() const { return pGeneration[stackPointer]; }
 
 private:
+    void touch() { pGeneration[stackPointer] = ++lastGeneration; }
+
     int     stackDepth;
     int     stackPointer;
     Matrix44    *pStack;
+    MatrixKind  *pKind;   // shape of each entry of pStack
+    unsigned long *pGeneration; // generation of each entry of pStack
+    unsigned long lastGeneration;
 };
 
 }
@@ -19,6 +19,8 @@
 
 #include "renderengine.h"
 #include "GL/glew.h"
+#include <cfloat>
+#include <cstring>
 #include <iostream>
 
 using namespace sm;
@@ -52,3 +54,88 @@ void RenderEngine::resizeScene(int width, int height)
     projectionMatrix.loadMatrix(viewFrustum.GetProjectionMatrix());
     transformPipeline.setMatrixStacks(modelViewMatix,projectionMatrix);
 }
+
+int RenderEngine::addView(Camera &camera, Frustum &frustum, int x, int y, int width, int height)
+{
+    size_t slot = 0;
+    while (slot < views.size() && views[slot].camera != nullptr)
+        slot++;
+    if (slot == views.size()) {
+        if (int(slot) >= ViewCuller::MAX_VIEWS) {
+            std::cerr<<"#ERROR: too many render views"<<std::endl;
+            return -1;
+        }
+        views.push_back(RenderView());
+    }
+
+    RenderView &view = views[slot];
+    view.camera = &camera;
+    view.frustum = &frustum;
+    view.queue.clear();
+    setViewport(int(slot), x, y, width, height);
+    return int(slot);
+}
+
+void RenderEngine::removeView(int view)
+{
+    views[view].camera = nullptr;
+    views[view].frustum = nullptr;
+    views[view].queue.clear();
+    while (!views.empty() && views.back().camera == nullptr)
+        views.pop_back();
+}
+
+void RenderEngine::setViewport(int view, int x, int y, int width, int height)
+{
+    views[view].x = x;
+    views[view].y = y;
+    views[view].width = width;
+    views[view].height = height;
+}
+
+void RenderEngine::cullViews()
+{
+    const int viewCount = int(views.size());
+    viewPlanes.resize(viewCount * Frustum::PLANE_COUNT);
+
+    for (int v = 0; v < viewCount; v++) {
+        Vector4 *planes = &viewPlanes[v * Frustum::PLANE_COUNT];
+        RenderView &view = views[v];
+        view.queue.clear();
+        if (view.camera == nullptr) {
+            // free slot, a plane nothing is in front of
+            for (int p = 0; p < Frustum::PLANE_COUNT; p++)
+                planes[p] = Vector4(0, 0, 0, -FLT_MAX);
+            continue;
+        }
+        // setting the projection dirties the camera state, only if it changed
+        const Matrix44 &projection = view.frustum->GetProjectionMatrix();
+        if (memcmp(projection.data(), view.camera->getProjectionMatrix().data(), sizeof(smReal) * 16) != 0)
+            view.camera->setProjectionMatrix(projection);
+        const Vector4 *cameraPlanes = view.camera->getFrustumPlanes();
+        for (int p = 0; p < Frustum::PLANE_COUNT; p++)
+            planes[p] = cameraPlanes[p];
+    }
+
+    culler.cull(viewPlanes.data(), viewCount, viewMasks);
+
+    // one more pass over the masks distributes the objects to every queue
+    const int objectCount = int(viewMasks.size());
+    for (int object = 0; object < objectCount; object++) {
+        for (ViewCuller::ViewMask mask = viewMasks[object]; mask != 0; mask &= mask - 1) {
+            int v = 0;
+            while (((mask >> v) & 1) == 0)
+                v++;
+            views[v].queue.push_back(object);
+        }
+    }
+}
+
+void RenderEngine::beginView(int view)
+{
+    const RenderView &renderView = views[view];
+    glViewport(renderView.x, renderView.y, renderView.width, renderView.height);
+    projectionMatrix.loadMatrix(renderView.frustum->GetProjectionMatrix());
+    modelViewMatix.loadMatrix(renderView.camera->getCameraMatrix());
+    transformPipeline.setMatrixStacks(modelViewMatix, projectionMatrix);
+}
@@ -23,6 +23,9 @@
 #include "matrixstack.h"
 #include "geometrytransform.h"
 #include "math/frustum.h"
+#include "camera.h"
+#include "viewculler.h"
+#include <vector>
 
 namespace sm {
 
@@ -35,13 +38,59 @@ public:
     void resizeScene(int width, int hight);
     void drawScene(float elapsed);
 
+    /**
+     * @brief Registers a view rendered every frame (main view, minimap,
+     * shadow cascade...)
+     *
+     * The camera and the frustum are not owned and must outlive the view.
+     * The frustum projection is read again at every cullViews().
+     *
+     * @return int the view, stable until removeView(), or -1 if there are
+     * already ViewCuller::MAX_VIEWS views
+     */
+    int addView(Camera &camera, Frustum &frustum, int x, int y, int width, int height);
+    void removeView(int view);
+    void setViewport(int view, int x, int y, int width, int height);
+
+    /** @brief Registers an object by its bounding sphere, @see ViewCuller */
+    int addObject(const Vector3 &center, smReal radius) { return culler.addObject(center, radius); }
+    void setObjectBounds(int object, const Vector3 &center, smReal radius) { culler.setBounds(object, center, radius); }
+    int removeObject(int object) { return culler.removeObject(object); }
+
+    /**
+     * @brief Culls all the objects against all the views in a single pass
+     *
+     * Fills the per-view queues returned by getViewQueue(), so adding views
+     * doesn't add passes over the scene.
+     */
+    void cullViews();
+    /** Objects visible in "view" as of the last cullViews(), in object order */
+    const std::vector<int>& getViewQueue(int view) const { return views[view].queue; }
+    /** Visibility of "object" in every view, bit "view" set if visible */
+    ViewCuller::ViewMask getViewMask(int object) const { return viewMasks[object]; }
+
+    /** Sets viewport and matrix stacks to render "view" */
+    void beginView(int view);
+
 private:
     void initGL();
+
+    struct RenderView {
+        Camera  *camera;    // nullptr if the slot is free
+        Frustum *frustum;
+        int x, y, width, height;
+        std::vector<int> queue;
+    };
     
     MatrixStack modelViewMatix;
     MatrixStack projectionMatrix;
     GeometryTransform transformPipeline;
     Frustum viewFrustum;
+
+    std::vector<RenderView> views;
+    ViewCuller culler;
+    std::vector<ViewCuller::ViewMask> viewMasks;
+    std::vector<Vector4> viewPlanes;
 };
 
 }
@@ -0,0 +1,108 @@
+/*
+ * Example of the OpenGL usage with SDL2
+ * Copyright (C) 2013 Matteo De Carlo <matteo.dek@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "mesh.h"
+
+using namespace sm;
+
+Mesh::Mesh()
+    : vertexArray(0), indexType(GL_UNSIGNED_INT), indexSize(4)
+{
+    buffers[0] = buffers[1] = 0;
+    for (int i = 0; i < 3; i++)
+        boundsMin[i] = boundsMax[i] = 0.0f;
+}
+
+Mesh::~Mesh()
+{
+    release();
+}
+
+bool Mesh::upload(const MeshFile &file, GLenum usage)
+{
+    if (!file.isOpen())
+        return false;
+    release();
+
+    const MeshFile::Header &header = file.getHeader();
+    indexType = header.indexSize == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    indexSize = GLsizei(header.indexSize);
+    lods.assign(file.getLods(), file.getLods() + header.lodCount);
+    for (int i = 0; i < 3; i++) {
+        boundsMin[i] = header.boundsMin[i];
+        boundsMax[i] = header.boundsMax[i];
+    }
+
+    glGenVertexArrays(1, &vertexArray);
+    glBindVertexArray(vertexArray);
+    glGenBuffers(2, buffers);
+
+    glBindBuffer(GL_ARRAY_BUFFER, buffers[0]);
+    glBufferData(GL_ARRAY_BUFFER, GLsizeiptr(file.getVertexDataSize()), file.getVertexData(), usage);
+    const MeshFile::Attribute *attributes = file.getAttributes();
+    for (uint32_t i = 0; i < header.attributeCount; i++) {
+        const MeshFile::Attribute &attribute = attributes[i];
+        glEnableVertexAttribArray(attribute.slot);
+        glVertexAttribPointer(attribute.slot, GLint(attribute.components), attribute.type,
+                              attribute.normalized ? GL_TRUE : GL_FALSE, GLsizei(header.vertexStride),
+                              reinterpret_cast<const GLvoid*>(size_t(attribute.offset)));
+    }
+
+    // element buffer binding is part of the vertex array state
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers[1]);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, GLsizeiptr(file.getIndexDataSize()), file.getIndexData(), usage);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return glGetError() == GL_NO_ERROR;
+}
+
+void Mesh::release()
+{
+    if (vertexArray == 0)
+        return;
+    glDeleteBuffers(2, buffers);
+    glDeleteVertexArrays(1, &vertexArray);
+    vertexArray = 0;
+    buffers[0] = buffers[1] = 0;
+    lods.clear();
+}
+
+void Mesh::draw(int lod) const
+{
+    if (vertexArray == 0 || lods.empty())
+        return;
+    if (lod >= int(lods.size()))
+        lod = int(lods.size()) - 1;
+
+    const MeshFile::Lod &range = lods[lod];
+    glBindVertexArray(vertexArray);
+    glDrawElements(GL_TRIANGLES, GLsizei(range.indexCount), indexType,
+                   reinterpret_cast<const GLvoid*>(size_t(range.firstIndex) * indexSize));
+    glBindVertexArray(0);
+}
+
+int Mesh::selectLod(float distance) const
+{
+    for (size_t i = 0; i + 1 < lods.size(); i++) {
+        if (distance <= lods[i].maxDistance)
+            return int(i);
+    }
+    return int(lods.size()) - 1;
+}
@@ -0,0 +1,69 @@
+/*
+ * Example of the OpenGL usage with SDL2
+ * Copyright (C) 2013 Matteo De Carlo <matteo.dek@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef SM_MESH_H
+#define SM_MESH_H
+
+#include "meshfile.h"
+#include "GL/glew.h"
+
+namespace sm {
+
+/**
+ * @brief Mesh in GPU buffers, with a vertex array object binding its
+ * attributes to the Shader::ATTRIBUTE_* slots
+ *
+ * upload() hands the mapped blobs of a MeshFile straight to glBufferData,
+ * the only copy made is the driver's own. The MeshFile can be closed
+ * right after.
+ */
+class Mesh
+{
+public:
+    Mesh();
+    ~Mesh();
+
+    bool upload(const MeshFile &file, GLenum usage = GL_STATIC_DRAW);
+    void release();
+
+    /** Draws "lod", clamped to the coarsest one */
+    void draw(int lod = 0) const;
+    /** Finest LOD whose maxDistance is not below "distance" */
+    int selectLod(float distance) const;
+
+    int getLodCount() const { return int(lods.size()); }
+    const float* getBoundsMin() const { return boundsMin; }
+    const float* getBoundsMax() const { return boundsMax; }
+
+private:
+    Mesh(const Mesh&);
+    Mesh& operator=(const Mesh&);
+
+    GLuint vertexArray;
+    GLuint buffers[2];      // vertices, indices
+    GLenum indexType;
+    GLsizei indexSize;
+    std::vector<MeshFile::Lod> lods;
+    float boundsMin[3];
+    float boundsMax[3];
+};
+
+}
+
+#endif // SM_MESH_H
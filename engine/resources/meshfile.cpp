@@ -0,0 +1,245 @@
+/*
+ * Example of the OpenGL usage with SDL2
+ * Copyright (C) 2013 Matteo De Carlo <matteo.dek@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "meshfile.h"
+#include "../errorhandling.h"
+#include <cstring>
+#include <fstream>
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace sm;
+
+namespace {
+    const char MAGIC[4] = { 'S', 'M', 'M', 'F' };
+    const uint32_t MAX_ATTRIBUTES = 16;
+    const uint64_t ALIGNMENT = 16;
+
+    uint64_t align(uint64_t offset)
+    {
+        return (offset + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    }
+
+    uint32_t typeSize(uint32_t type)
+    {
+        switch (type) {
+        case 0x1400: // GL_BYTE
+        case 0x1401: // GL_UNSIGNED_BYTE
+            return 1;
+        case 0x1402: // GL_SHORT
+        case 0x1403: // GL_UNSIGNED_SHORT
+        case 0x140B: // GL_HALF_FLOAT
+            return 2;
+        case 0x1404: // GL_INT
+        case 0x1405: // GL_UNSIGNED_INT
+        case 0x1406: // GL_FLOAT
+            return 4;
+        default:
+            return 0;
+        }
+    }
+}
+
+MeshFile::MeshFile()
+    : data(nullptr), size(0), mapped(false)
+{
+}
+
+MeshFile::~MeshFile()
+{
+    close();
+}
+
+bool MeshFile::open(const std::string &path)
+{
+    close();
+
+#ifndef WIN32
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        emitError("could not open mesh " + path);
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || size_t(info.st_size) < sizeof(Header)) {
+        ::close(fd);
+        emitError(path + " is not a mesh");
+        return false;
+    }
+
+    void *mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        emitError("could not map mesh " + path);
+        return false;
+    }
+    // read once front to back by the upload, start reading ahead now
+    madvise(mapping, info.st_size, MADV_SEQUENTIAL);
+    madvise(mapping, info.st_size, MADV_WILLNEED);
+
+    data = static_cast<const char*>(mapping);
+    size = size_t(info.st_size);
+    mapped = true;
+#else
+    std::ifstream stream(path.c_str(), std::ios_base::in | std::ios_base::binary);
+    if (!stream) {
+        emitError("could not open mesh " + path);
+        return false;
+    }
+    stream.seekg(0, std::ios_base::end);
+    size = size_t(stream.tellg());
+    stream.seekg(0, std::ios_base::beg);
+
+    char *buffer = new char[size];
+    data = buffer;
+    mapped = false;
+    if (size < sizeof(Header) || !stream.read(buffer, size)) {
+        close();
+        emitError(path + " is not a mesh");
+        return false;
+    }
+#endif
+
+    if (!validate(path)) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MeshFile::close()
+{
+    if (data == nullptr)
+        return;
+#ifndef WIN32
+    if (mapped)
+        munmap(const_cast<char*>(data), size);
+    else
+#endif
+        delete[] data;
+    data = nullptr;
+    size = 0;
+}
+
+bool MeshFile::validate(const std::string &path) const
+{
+    const Header &header = getHeader();
+    if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) {
+        emitError(path + " is not a mesh");
+        return false;
+    }
+    if (header.version != VERSION) {
+        emitError(path + ": unsupported mesh version");
+        return false;
+    }
+
+    // offsets are checked against the size first, so that the sums below
+    // can't wrap around even with a forged 64 bit offset
+    const uint64_t tablesEnd = sizeof(Header) + uint64_t(header.attributeCount) * sizeof(Attribute)
+                             + uint64_t(header.lodCount) * sizeof(Lod);
+    if (header.attributeCount > MAX_ATTRIBUTES || header.lodCount > MAX_LODS
+            || (header.indexSize != 2 && header.indexSize != 4)
+            || header.vertexOffset % ALIGNMENT != 0 || header.indexOffset % ALIGNMENT != 0
+            || header.vertexOffset > size || header.indexOffset > size
+            || header.vertexOffset < tablesEnd) {
+        emitError(path + ": corrupted mesh tables");
+        return false;
+    }
+    const uint64_t vertexBytes = uint64_t(header.vertexCount) * header.vertexStride;
+    const uint64_t indexBytes = uint64_t(header.indexCount) * header.indexSize;
+    if (vertexBytes > size - header.vertexOffset || indexBytes > size - header.indexOffset
+            || header.indexOffset < header.vertexOffset + vertexBytes) {
+        emitError(path + ": corrupted mesh tables");
+        return false;
+    }
+
+    const Attribute *attributes = getAttributes();
+    for (uint32_t i = 0; i < header.attributeCount; i++) {
+        const Attribute &attribute = attributes[i];
+        const uint32_t bytes = typeSize(attribute.type) * attribute.components;
+        if (attribute.slot >= MAX_ATTRIBUTES || attribute.components < 1 || attribute.components > 4
+                || bytes == 0 || uint64_t(attribute.offset) + bytes > header.vertexStride) {
+            emitError(path + ": invalid mesh attribute");
+            return false;
+        }
+    }
+
+    const Lod *lods = getLods();
+    for (uint32_t i = 0; i < header.lodCount; i++) {
+        if (uint64_t(lods[i].firstIndex) + lods[i].indexCount > header.indexCount) {
+            emitError(path + ": invalid mesh LOD");
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool MeshFile::write(const std::string &path, const Description &mesh)
+{
+    std::vector<Lod> lods = mesh.lods;
+    if (lods.empty()) {
+        Lod all = { 0, mesh.indexCount, 0.0f, 0 };
+        lods.push_back(all);
+    }
+
+    Header header;
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.vertexCount = mesh.vertexCount;
+    header.vertexStride = mesh.vertexStride;
+    header.attributeCount = uint32_t(mesh.attributes.size());
+    header.indexCount = mesh.indexCount;
+    header.indexSize = mesh.indexSize;
+    header.lodCount = uint32_t(lods.size());
+    for (int i = 0; i < 3; i++) {
+        header.boundsMin[i] = mesh.boundsMin[i];
+        header.boundsMax[i] = mesh.boundsMax[i];
+    }
+    const uint64_t tablesEnd = sizeof(Header) + mesh.attributes.size() * sizeof(Attribute) + lods.size() * sizeof(Lod);
+    header.vertexOffset = align(tablesEnd);
+    header.indexOffset = align(header.vertexOffset + uint64_t(mesh.vertexCount) * mesh.vertexStride);
+
+    std::ofstream stream(path.c_str(), std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+    if (!stream) {
+        emitError("could not create mesh " + path);
+        return false;
+    }
+
+    const char padding[ALIGNMENT] = { 0 };
+    stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (!mesh.attributes.empty())
+        stream.write(reinterpret_cast<const char*>(&mesh.attributes[0]), mesh.attributes.size() * sizeof(Attribute));
+    stream.write(reinterpret_cast<const char*>(&lods[0]), lods.size() * sizeof(Lod));
+    stream.write(padding, header.vertexOffset - tablesEnd);
+    stream.write(static_cast<const char*>(mesh.vertices), uint64_t(mesh.vertexCount) * mesh.vertexStride);
+    stream.write(padding, header.indexOffset - header.vertexOffset - uint64_t(mesh.vertexCount) * mesh.vertexStride);
+    stream.write(static_cast<const char*>(mesh.indices), uint64_t(mesh.indexCount) * mesh.indexSize);
+
+    if (!stream) {
+        emitError("could not write mesh " + path);
+        return false;
+    }
+    return true;
+}
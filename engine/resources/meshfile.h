@@ -0,0 +1,130 @@
+/*
+ * Example of the OpenGL usage with SDL2
+ * Copyright (C) 2013 Matteo De Carlo <matteo.dek@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef SM_MESHFILE_H
+#define SM_MESHFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace sm {
+
+/**
+ * @brief Binary mesh container, memory mapped
+ *
+ * Layout of a file, little endian, every blob 16 bytes aligned:
+ *
+ *     Header
+ *     Attribute[attributeCount]
+ *     Lod[lodCount]
+ *     vertices   vertexCount * vertexStride bytes, interleaved
+ *     indices    indexCount * indexSize bytes
+ *
+ * Attributes name the Shader::ATTRIBUTE_* slot they are bound to, and use
+ * OpenGL type enums, so the vertex blob goes to the GPU as it is. LODs are
+ * ranges of the index blob, finest first.
+ *
+ * open() only maps the file and validates the tables, the blobs are paged
+ * in by the reads of the upload.
+ */
+class MeshFile
+{
+public:
+    static const uint32_t VERSION = 1;
+    static const uint32_t MAX_LODS = 16;
+
+    struct Header {
+        char     magic[4];          // "SMMF"
+        uint32_t version;
+        uint32_t vertexCount;
+        uint32_t vertexStride;      // bytes
+        uint32_t attributeCount;
+        uint32_t indexCount;
+        uint32_t indexSize;         // 2 or 4 bytes
+        uint32_t lodCount;
+        float    boundsMin[3];
+        float    boundsMax[3];
+        uint64_t vertexOffset;      // from the start of the file
+        uint64_t indexOffset;
+    };
+
+    struct Attribute {
+        uint32_t slot;              // Shader::ATTRIBUTE_*
+        uint32_t components;        // 1 to 4
+        uint32_t type;              // GL_FLOAT, GL_UNSIGNED_BYTE...
+        uint32_t normalized;
+        uint32_t offset;            // in the vertex
+    };
+
+    struct Lod {
+        uint32_t firstIndex;
+        uint32_t indexCount;
+        float    maxDistance;       // use the next LOD farther than this
+        uint32_t reserved;
+    };
+
+    /** Contents of a mesh to write(), pointers owned by the caller */
+    struct Description {
+        std::vector<Attribute> attributes;
+        uint32_t vertexCount;
+        uint32_t vertexStride;
+        const void *vertices;
+        uint32_t indexCount;
+        uint32_t indexSize;
+        const void *indices;
+        std::vector<Lod> lods;      // if empty, a single LOD of all indices
+        float boundsMin[3];
+        float boundsMax[3];
+    };
+
+    MeshFile();
+    ~MeshFile();
+
+    /** @return bool false if the file can't be read or is not a valid mesh */
+    bool open(const std::string &path);
+    void close();
+    bool isOpen() const { return data != nullptr; }
+
+    static bool write(const std::string &path, const Description &mesh);
+
+    const Header& getHeader() const { return *reinterpret_cast<const Header*>(data); }
+    const Attribute* getAttributes() const { return reinterpret_cast<const Attribute*>(data + sizeof(Header)); }
+    const Lod* getLods() const { return reinterpret_cast<const Lod*>(getAttributes() + getHeader().attributeCount); }
+
+    const void* getVertexData() const { return data + getHeader().vertexOffset; }
+    size_t getVertexDataSize() const { return size_t(getHeader().vertexCount) * getHeader().vertexStride; }
+    const void* getIndexData() const { return data + getHeader().indexOffset; }
+    size_t getIndexDataSize() const { return size_t(getHeader().indexCount) * getHeader().indexSize; }
+
+private:
+    MeshFile(const MeshFile&);
+    MeshFile& operator=(const MeshFile&);
+
+    bool validate(const std::string &path) const;
+
+    const char *data;
+    size_t size;
+    bool mapped;                    // else data was allocated
+};
+
+}
+
+#endif // SM_MESHFILE_H
@@ -0,0 +1,362 @@
+/*
+ * Example of the OpenGL usage with SDL2
+ * Copyright (C) 2013 Matteo De Carlo <matteo.dek@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "textureloader.h"
+#include "../errorhandling.h"
+#include "../shaders/shadersource.h"
+#include "../timer.h"
+#include <cstring>
+
+using namespace sm;
+
+namespace {
+    const size_t BYTES_PER_PIXEL = 4;
+    const int MAX_SIZE = 16384;
+
+    inline unsigned int read16(const unsigned char *p)
+    {
+        return p[0] | (p[1] << 8);
+    }
+}
+
+void TextureImage::generateMipmaps()
+{
+    levels.resize(1);
+    while (levels.back().width > 1 || levels.back().height > 1) {
+        const Level &source = levels.back();
+        Level next;
+        next.width = source.width > 1 ? source.width / 2 : 1;
+        next.height = source.height > 1 ? source.height / 2 : 1;
+        next.pixels.resize(size_t(next.width) * next.height * BYTES_PER_PIXEL);
+
+        // odd sizes drop the last row or column, clamped at 1
+        const int stepX = source.width > 1 ? 1 : 0, stepY = source.height > 1 ? 1 : 0;
+        for (int y = 0; y < next.height; y++) {
+            const unsigned char *row0 = &source.pixels[size_t(2 * y) * source.width * BYTES_PER_PIXEL];
+            const unsigned char *row1 = row0 + size_t(stepY) * source.width * BYTES_PER_PIXEL;
+            unsigned char *out = &next.pixels[size_t(y) * next.width * BYTES_PER_PIXEL];
+            for (int x = 0; x < next.width; x++) {
+                const size_t a = size_t(2 * x) * BYTES_PER_PIXEL, b = a + stepX * BYTES_PER_PIXEL;
+                for (size_t c = 0; c < BYTES_PER_PIXEL; c++)
+                    out[x * BYTES_PER_PIXEL + c] = (unsigned char)((row0[a + c] + row0[b + c] + row1[a + c] + row1[b + c] + 2) >> 2);
+            }
+        }
+        levels.push_back(Level());
+        levels.back().width = next.width;
+        levels.back().height = next.height;
+        levels.back().pixels.swap(next.pixels);
+    }
+}
+
+Texture::~Texture()
+{
+    if (id != 0)
+        glDeleteTextures(1, &id);
+}
+
+bool TextureLoader::decodeTga(const std::string &path, const std::string &contents, TextureImage &image)
+{
+    const unsigned char *data = reinterpret_cast<const unsigned char*>(contents.data());
+    const size_t size = contents.size();
+    if (size < 18) {
+        emitError(path + " is not a TGA image");
+        return false;
+    }
+
+    const unsigned int idLength = data[0];
+    const unsigned int colorMapType = data[1];
+    const unsigned int imageType = data[2];
+    const int width = int(read16(data + 12));
+    const int height = int(read16(data + 14));
+    const unsigned int depth = data[16];
+    const bool topFirst = (data[17] & 0x20) != 0;
+    const bool rle = imageType == 10 || imageType == 11;
+    const bool gray = imageType == 3 || imageType == 11;
+    const size_t sourceBytes = depth / 8;
+
+    if (colorMapType != 0 || (imageType != 2 && imageType != 3 && imageType != 10 && imageType != 11)
+            || (gray ? depth != 8 : (depth != 24 && depth != 32)) || width == 0 || height == 0 || width > MAX_SIZE || height > MAX_SIZE) {
+        emitError(path + ": unsupported TGA image");
+        return false;
+    }
+
+    TextureImage::Level level;
+    level.width = width;
+    level.height = height;
+    level.pixels.resize(size_t(width) * height * BYTES_PER_PIXEL);
+
+    const size_t pixelCount = size_t(width) * height;
+    size_t in = 18 + idLength;
+    size_t pixel = 0;
+    while (pixel < pixelCount) {
+        // a raw packet, or a run of one repeated value
+        size_t count = 1;
+        bool repeat = false;
+        if (rle) {
+            if (in >= size)
+                break;
+            count = (data[in] & 0x7F) + 1;
+            repeat = (data[in] & 0x80) != 0;
+            in++;
+            if (count > pixelCount - pixel)
+                break;
+        }
+        if (in + (repeat ? 1 : count) * sourceBytes > size)
+            break;
+
+        for (size_t i = 0; i < count; i++, pixel++) {
+            const unsigned char *p = data + in;
+            const size_t row = pixel / width, column = pixel % width;
+            unsigned char *out = &level.pixels[((topFirst ? height - 1 - row : row) * width + column) * BYTES_PER_PIXEL];
+            if (gray) {
+                out[0] = out[1] = out[2] = p[0];
+                out[3] = 255;
+            } else {
+                // stored BGR(A)
+                out[0] = p[2];
+                out[1] = p[1];
+                out[2] = p[0];
+                out[3] = depth == 32 ? p[3] : 255;
+            }
+            if (!repeat)
+                in += sourceBytes;
+        }
+        if (repeat)
+            in += sourceBytes;
+    }
+
+    if (pixel < pixelCount) {
+        emitError(path + ": truncated TGA image");
+        return false;
+    }
+
+    image.levels.clear();
+    image.levels.push_back(TextureImage::Level());
+    image.levels[0].width = width;
+    image.levels[0].height = height;
+    image.levels[0].pixels.swap(level.pixels);
+    return true;
+}
+
+TextureLoader::TextureLoader(int workerCount)
+    : decoder(&TextureLoader::decodeTga), frame(0), uploadBudget(size_t(4) << 20),
+      frameBytes(0), frameSeconds(0), totalBytes(0), totalSeconds(0),
+      decodingCount(0), stopping(false)
+{
+    // magenta and grey checker, hard to miss
+    const unsigned char checker[16] = { 255, 0, 255, 255,  128, 128, 128, 255,
+                                        128, 128, 128, 255,  255, 0, 255, 255 };
+    glGenTextures(1, &placeholder);
+    glBindTexture(GL_TEXTURE_2D, placeholder);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 2, 2, 0, GL_RGBA, GL_UNSIGNED_BYTE, checker);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenBuffers(PBO_COUNT, pixelBuffers);
+
+    for (int i = 0; i < workerCount; i++)
+        workers.push_back(std::thread(&TextureLoader::workerLoop, this));
+}
+
+TextureLoader::~TextureLoader()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        queue.clear();
+    }
+    queueCondition.notify_all();
+    for (size_t i = 0; i < workers.size(); i++)
+        workers[i].join();
+
+    glDeleteBuffers(PBO_COUNT, pixelBuffers);
+    glDeleteTextures(1, &placeholder);
+}
+
+std::shared_ptr<Texture> TextureLoader::load(const std::string &path)
+{
+    Request request;
+    request.texture.reset(new Texture(path, placeholder));
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.push_back(request);
+    }
+    queueCondition.notify_one();
+    return request.texture;
+}
+
+int TextureLoader::getPendingCount() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return int(queue.size() + decoded.size() + uploads.size()) + decodingCount;
+}
+
+void TextureLoader::workerLoop()
+{
+    while (true) {
+        Request request;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (queue.empty() && !stopping)
+                queueCondition.wait(lock);
+            if (stopping)
+                break;
+            request = queue.front();
+            queue.pop_front();
+            decodingCount++;
+        }
+
+        std::string contents;
+        std::shared_ptr<TextureImage> image(new TextureImage);
+        if (!ShaderSource::readFile(request.texture->getPath(), contents)) {
+            emitError("could not read texture " + request.texture->getPath());
+        } else if (decoder(request.texture->getPath(), contents, *image) && !image->levels.empty()) {
+            image->generateMipmaps();
+            request.image = image;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        decoded.push_back(request);
+        decodingCount--;
+    }
+}
+
+void TextureLoader::allocate(Upload &upload)
+{
+    Texture &texture = *upload.request.texture;
+    const TextureImage &image = *upload.request.image;
+
+    glGenTextures(1, &texture.id);
+    glBindTexture(GL_TEXTURE_2D, texture.id);
+    for (size_t level = 0; level < image.levels.size(); level++) {
+        glTexImage2D(GL_TEXTURE_2D, GLint(level), GL_RGBA8, image.levels[level].width, image.levels[level].height,
+                     0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, GLint(image.levels.size()) - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    texture.width = image.levels[0].width;
+    texture.height = image.levels[0].height;
+}
+
+void TextureLoader::update()
+{
+    Timer timer;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t i = 0; i < decoded.size(); i++) {
+            if (decoded[i].image == nullptr) {
+                decoded[i].texture->failed = true;
+                continue;
+            }
+            Upload upload = { decoded[i], 0, 0, false };
+            uploads.push_back(upload);
+        }
+        decoded.clear();
+    }
+
+    // plan this frame's rows
+    pieces.clear();
+    size_t bytes = 0;
+    for (size_t u = 0; u < uploads.size() && bytes < uploadBudget; u++) {
+        Upload &upload = uploads[u];
+        if (upload.request.texture.use_count() == 1) {
+            // nobody wants it anymore
+            upload.level = int(upload.request.image->levels.size());
+            upload.dropped = true;
+            continue;
+        }
+        if (upload.request.texture->id == 0)
+            allocate(upload);
+
+        while (upload.level < int(upload.request.image->levels.size()) && bytes < uploadBudget) {
+            const TextureImage::Level &level = upload.request.image->levels[upload.level];
+            const size_t rowBytes = size_t(level.width) * BYTES_PER_PIXEL;
+            // at least a row per frame, whatever the budget
+            int rows = int((uploadBudget - bytes) / rowBytes);
+            if (rows < 1)
+                rows = bytes == 0 ? 1 : 0;
+            if (rows == 0)
+                break;
+            if (rows > level.height - upload.row)
+                rows = level.height - upload.row;
+
+            Piece piece = { &upload, upload.request.texture->id, upload.level, upload.row, rows, &level, bytes };
+            pieces.push_back(piece);
+            bytes += size_t(rows) * rowBytes;
+
+            upload.row += rows;
+            if (upload.row == level.height) {
+                upload.level++;
+                upload.row = 0;
+            }
+        }
+    }
+
+    if (!pieces.empty()) {
+        // orphan the buffer of this frame and fill it
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffers[frame % PBO_COUNT]);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, GLsizeiptr(bytes), nullptr, GL_STREAM_DRAW);
+        char *mapping = static_cast<char*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, GLsizeiptr(bytes),
+                                                            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+        if (mapping != nullptr) {
+            for (size_t p = 0; p < pieces.size(); p++) {
+                const Piece &piece = pieces[p];
+                const size_t rowBytes = size_t(piece.source->width) * BYTES_PER_PIXEL;
+                memcpy(mapping + piece.offset, &piece.source->pixels[piece.row * rowBytes], piece.rows * rowBytes);
+            }
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+            for (size_t p = 0; p < pieces.size(); p++) {
+                const Piece &piece = pieces[p];
+                glBindTexture(GL_TEXTURE_2D, piece.texture);
+                glTexSubImage2D(GL_TEXTURE_2D, piece.level, 0, piece.row, piece.source->width, piece.rows,
+                                GL_RGBA, GL_UNSIGNED_BYTE, reinterpret_cast<const GLvoid*>(piece.offset));
+            }
+        } else {
+            emitError("could not map the texture upload buffer");
+            // retry the same rows next frame
+            for (size_t p = pieces.size(); p-- > 0; ) {
+                pieces[p].upload->level = pieces[p].level;
+                pieces[p].upload->row = pieces[p].row;
+            }
+            bytes = 0;
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+    frame++;
+
+    // completed textures become visible, their pixels are not needed anymore
+    while (!uploads.empty() && uploads.front().level == int(uploads.front().request.image->levels.size())) {
+        if (!uploads.front().dropped)
+            uploads.front().request.texture->resident = true;
+        uploads.pop_front();
+    }
+
+    frameBytes = bytes;
+    frameSeconds = timer.getElapsedSeconds();
+    totalBytes += bytes;
+    totalSeconds += frameSeconds;
+}
@@ -0,0 +1,191 @@
+/*
+ * Example of the OpenGL usage with SDL2
+ * Copyright (C) 2013 Matteo De Carlo <matteo.dek@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef SM_TEXTURELOADER_H
+#define SM_TEXTURELOADER_H
+
+#include "GL/glew.h"
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace sm {
+
+class TextureLoader;
+
+/** @brief RGBA8 image with its mipmap chain, bottom row first like OpenGL */
+struct TextureImage
+{
+    struct Level {
+        int width, height;
+        std::vector<unsigned char> pixels;
+    };
+    std::vector<Level> levels;
+
+    /** Fills levels[1...] from levels[0], 2x2 box filter down to 1x1 */
+    void generateMipmaps();
+};
+
+/**
+ * @brief A texture being loaded by a TextureLoader
+ *
+ * getId() is the placeholder texture of the loader until the whole mip
+ * chain is uploaded, then the texture itself.
+ */
+class Texture
+{
+    friend class TextureLoader;
+public:
+    /** Deletes the texture, must happen on the thread owning the OpenGL context */
+    ~Texture();
+
+    GLuint getId() const { return resident ? id : placeholder; }
+    bool isResident() const { return resident; }
+    /** false if the file couldn't be read or decoded, the placeholder stays */
+    bool hasFailed() const { return failed; }
+    const std::string& getPath() const { return path; }
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+
+private:
+    explicit Texture(const std::string &path, GLuint placeholder)
+        : path(path), id(0), placeholder(placeholder), resident(false), failed(false), width(0), height(0) {}
+    Texture(const Texture&);
+    Texture& operator=(const Texture&);
+
+    std::string path;
+    GLuint id;
+    GLuint placeholder;
+    bool resident;
+    bool failed;
+    int width, height;
+};
+
+/**
+ * @brief Loads textures without stalling the frames
+ *
+ * Files are read, decoded and mipmapped on worker threads. Every frame,
+ * update() uploads the decoded images a few rows at a time until the frame
+ * budget of bytes is spent: the rows are copied into a pixel buffer object
+ * and handed to glTexSubImage2D from there, so the transfer overlaps with
+ * rendering. A ring of PBOs, one per frame in flight, keeps the copy from
+ * waiting on a buffer the GPU is still reading.
+ *
+ * Textures not referenced anymore by anybody but the loader are dropped
+ * before being uploaded.
+ *
+ * TGA files (uncompressed or RLE, 8, 24 or 32 bit) are decoded natively,
+ * other formats need a Decoder.
+ */
+class TextureLoader
+{
+public:
+    /** Decodes "contents" of the file "path" into image.levels[0] */
+    typedef std::function<bool(const std::string &path, const std::string &contents, TextureImage &image)> Decoder;
+
+    static const int PBO_COUNT = 3;
+
+    /** On the thread owning the OpenGL context */
+    explicit TextureLoader(int workerCount = 2);
+    ~TextureLoader();
+
+    std::shared_ptr<Texture> load(const std::string &path);
+
+    /** Decoder used instead of the TGA one */
+    void setDecoder(const Decoder &decoder) { this->decoder = decoder; }
+    static bool decodeTga(const std::string &path, const std::string &contents, TextureImage &image);
+
+    /** Bytes uploaded per frame, at least a row of a texture is */
+    void setUploadBudget(size_t bytes) { uploadBudget = bytes; }
+
+    /** Once per frame, on the thread owning the OpenGL context */
+    void update();
+
+    GLuint getPlaceholder() const { return placeholder; }
+    int getPendingCount() const;
+
+    /** Bytes uploaded by the last update(), and the time spent on them */
+    size_t getFrameUploadBytes() const { return frameBytes; }
+    double getFrameUploadSeconds() const { return frameSeconds; }
+    /** Bytes per second of update() time, since construction */
+    double getUploadBandwidth() const { return totalSeconds > 0 ? double(totalBytes) / totalSeconds : 0.0; }
+
+private:
+    struct Request {
+        std::shared_ptr<Texture> texture;
+        std::shared_ptr<TextureImage> image;   // null until decoded, or if failed
+    };
+
+    /** Progress of the texture being uploaded */
+    struct Upload {
+        Request request;
+        int level;
+        int row;
+        bool dropped;
+    };
+
+    /** Rows of a level copied at "offset" of this frame's PBO */
+    struct Piece {
+        Upload *upload;
+        GLuint texture;
+        int level;
+        int row, rows;
+        const TextureImage::Level *source;
+        size_t offset;
+    };
+
+    TextureLoader(const TextureLoader&);
+    TextureLoader& operator=(const TextureLoader&);
+
+    void workerLoop();
+    /** Creates the texture with all its levels, empty */
+    void allocate(Upload &upload);
+
+    Decoder decoder;
+    GLuint placeholder;
+    GLuint pixelBuffers[PBO_COUNT];
+    int frame;
+
+    size_t uploadBudget;
+    std::deque<Upload> uploads;        // decoded, in upload order
+    std::vector<Piece> pieces;         // scratch of update()
+
+    size_t frameBytes;
+    double frameSeconds;
+    unsigned long long totalBytes;
+    double totalSeconds;
+
+    // shared with the workers
+    mutable std::mutex mutex;
+    std::condition_variable queueCondition;
+    std::deque<Request> queue;
+    std::vector<Request> decoded;
+    int decodingCount;
+    bool stopping;
+    std::vector<std::thread> workers;
+};
+
+}
+
+#endif // SM_TEXTURELOADER_H
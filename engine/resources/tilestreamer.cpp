@@ -0,0 +1,272 @@
+/*
+ * Example of the OpenGL usage with SDL2
+ * Copyright (C) 2013 Matteo De Carlo <matteo.dek@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "tilestreamer.h"
+#include "../camera.h"
+#include "../timer.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace sm;
+
+TileStreamer::TileStreamer(int tilesX, int tilesZ, float tileSize, const Loader &loader, int workerCount)
+    : tilesX(tilesX), tilesZ(tilesZ), tileSize(tileSize), loader(loader),
+      loadDistance(4.0f * tileSize), uploadBudget(0.002), ramBudget(size_t(512) << 20),
+      vramBudget(size_t(512) << 20), outOfViewPenalty(4.0f), tiles(tilesX * tilesZ),
+      frame(0), cpuBytes(0), gpuBytes(0), residentCount(0), uploadSeconds(0),
+      overBudget(false), maxQueued(std::max(4, 4 * workerCount)), stopping(false)
+{
+    for (size_t i = 0; i < tiles.size(); i++) {
+        tiles[i].state.store(UNLOADED, std::memory_order_relaxed);
+        tiles[i].priority = 0.0f;
+        tiles[i].lastVisible = 0;
+        tiles[i].lastWanted = 0;
+    }
+
+    for (int i = 0; i < workerCount; i++)
+        workers.push_back(std::thread(&TileStreamer::workerLoop, this));
+}
+
+TileStreamer::~TileStreamer()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        loadQueue.clear();
+    }
+    queueCondition.notify_all();
+    for (size_t i = 0; i < workers.size(); i++)
+        workers[i].join();
+
+    for (size_t i = 0; i < tiles.size(); i++) {
+        if (tiles[i].state == UPLOADING || tiles[i].state == RESIDENT)
+            tiles[i].data->unload();
+    }
+}
+
+void TileStreamer::workerLoop()
+{
+    while (true) {
+        int tile;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (loadQueue.empty() && !stopping)
+                queueCondition.wait(lock);
+            if (stopping)
+                break;
+            tile = loadQueue.back();
+            loadQueue.pop_back();
+            tiles[tile].state = LOADING;
+        }
+
+        StreamedTile *data = loader(tile % tilesX, tile / tilesX);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        tiles[tile].data.reset(data);
+        decoded.push_back(tile);
+    }
+}
+
+void TileStreamer::update(Camera &camera)
+{
+    frame++;
+    const Vector3 position = camera.getPosition();
+    const Vector4 *planes = camera.getFrustumPlanes();
+    const float radius = tileSize * 0.70710678f;
+
+    // tiles around the camera: visibility and priority
+    candidates.clear();
+    const int minX = std::max(0, int(std::floor((position.get(0) - loadDistance) / tileSize)));
+    const int maxX = std::min(tilesX - 1, int(std::floor((position.get(0) + loadDistance) / tileSize)));
+    const int minZ = std::max(0, int(std::floor((position.get(2) - loadDistance) / tileSize)));
+    const int maxZ = std::min(tilesZ - 1, int(std::floor((position.get(2) + loadDistance) / tileSize)));
+    for (int z = minZ; z <= maxZ; z++) {
+        for (int x = minX; x <= maxX; x++) {
+            const float centerX = (x + 0.5f) * tileSize, centerZ = (z + 0.5f) * tileSize;
+            const float dx = centerX - position.get(0), dz = centerZ - position.get(2);
+            const float distance = std::sqrt(dx * dx + dz * dz);
+            if (distance > loadDistance + radius)
+                continue;
+
+            // tiles are flat, tested as spheres centered on the ground
+            bool inView = true;
+            for (int p = 0; p < Frustum::PLANE_COUNT && inView; p++) {
+                const smReal *plane = planes[p].data();
+                inView = plane[0] * centerX + plane[2] * centerZ + plane[3] >= -radius;
+            }
+
+            Tile &tile = tiles[z * tilesX + x];
+            tile.priority = inView ? distance : distance * outOfViewPenalty + loadDistance;
+            tile.lastWanted = frame;
+            if (inView)
+                tile.lastVisible = frame;
+            candidates.push_back(z * tilesX + x);
+        }
+    }
+
+    // failed tiles are tried again only once they left the load range
+    for (size_t i = 0; i < failed.size();) {
+        if (tiles[failed[i]].lastWanted != frame) {
+            tiles[failed[i]].state = UNLOADED;
+            failed[i] = failed.back();
+            failed.pop_back();
+        } else {
+            i++;
+        }
+    }
+
+    bool wakeWorkers;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        for (size_t i = 0; i < decoded.size(); i++) {
+            Tile &tile = tiles[decoded[i]];
+            if (tile.lastWanted != frame) {
+                // went out of range while loading: try again later
+                tile.data.reset();
+                tile.state = UNLOADED;
+                continue;
+            }
+            if (tile.data == nullptr) {
+                tile.state = FAILED;
+                failed.push_back(decoded[i]);
+                continue;
+            }
+            tile.state = DECODED;
+            cpuBytes += tile.data->getCpuBytes();
+            uploadQueue.push_back(decoded[i]);
+        }
+        decoded.clear();
+
+        // requeue the missing tiles, best last. Near the budget only the
+        // tiles in view are worth loading, the others would be evicted
+        for (size_t i = 0; i < loadQueue.size(); i++)
+            tiles[loadQueue[i]].state = UNLOADED;
+        loadQueue.clear();
+        const bool nearBudget = cpuBytes >= ramBudget || gpuBytes >= vramBudget;
+        if (!overBudget) {
+            for (size_t i = 0; i < candidates.size(); i++) {
+                const Tile &tile = tiles[candidates[i]];
+                if (tile.state == UNLOADED && (!nearBudget || tile.lastVisible == frame))
+                    loadQueue.push_back(candidates[i]);
+            }
+            std::sort(loadQueue.begin(), loadQueue.end(), [this](int a, int b) {
+                return tiles[a].priority < tiles[b].priority;
+            });
+            // a few at a time, so that memory is checked again before more
+            if (int(loadQueue.size()) > maxQueued)
+                loadQueue.resize(maxQueued);
+            std::reverse(loadQueue.begin(), loadQueue.end());
+            for (size_t i = 0; i < loadQueue.size(); i++)
+                tiles[loadQueue[i]].state = QUEUED;
+        }
+        wakeWorkers = !loadQueue.empty();
+    }
+    if (wakeWorkers)
+        queueCondition.notify_all();
+
+    std::sort(uploadQueue.begin(), uploadQueue.end(), [this](int a, int b) {
+        return tiles[a].priority < tiles[b].priority;
+    });
+    uploadTiles();
+    evict();
+}
+
+void TileStreamer::uploadTiles()
+{
+    Timer timer;
+    size_t done = 0;
+    for (; done < uploadQueue.size(); done++) {
+        if (timer.getElapsedSeconds() >= uploadBudget)
+            break;
+
+        Tile &tile = tiles[uploadQueue[done]];
+        tile.state = UPLOADING;
+        bool complete = tile.data->upload();
+        while (!complete && timer.getElapsedSeconds() < uploadBudget)
+            complete = tile.data->upload();
+        if (!complete)
+            break;
+
+        tile.state = RESIDENT;
+        gpuBytes += tile.data->getGpuBytes();
+        residentCount++;
+    }
+    uploadQueue.erase(uploadQueue.begin(), uploadQueue.begin() + done);
+    uploadSeconds = timer.getElapsedSeconds();
+}
+
+void TileStreamer::release(int index)
+{
+    Tile &tile = tiles[index];
+    if (tile.state == RESIDENT) {
+        gpuBytes -= tile.data->getGpuBytes();
+        residentCount--;
+    }
+    if (tile.state == UPLOADING || tile.state == RESIDENT)
+        tile.data->unload();
+    cpuBytes -= tile.data->getCpuBytes();
+    tile.data.reset();
+    tile.state = UNLOADED;
+}
+
+void TileStreamer::evict()
+{
+    overBudget = false;
+    if (cpuBytes <= ramBudget && gpuBytes <= vramBudget)
+        return;
+
+    // least recently visible first, tiles in view are kept
+    candidates.clear();
+    for (size_t i = 0; i < tiles.size(); i++) {
+        const State state = tiles[i].state;
+        if ((state == DECODED || state == UPLOADING || state == RESIDENT) && tiles[i].lastVisible != frame)
+            candidates.push_back(int(i));
+    }
+    std::sort(candidates.begin(), candidates.end(), [this](int a, int b) {
+        if (tiles[a].lastVisible != tiles[b].lastVisible)
+            return tiles[a].lastVisible < tiles[b].lastVisible;
+        return tiles[a].priority > tiles[b].priority;
+    });
+
+    for (size_t i = 0; i < candidates.size() && (cpuBytes > ramBudget || gpuBytes > vramBudget); i++) {
+        const int tile = candidates[i];
+        if (tiles[tile].state != RESIDENT)
+            uploadQueue.erase(std::find(uploadQueue.begin(), uploadQueue.end(), tile));
+        release(tile);
+    }
+    overBudget = cpuBytes > ramBudget || gpuBytes > vramBudget;
+}
+
+StreamedTile* TileStreamer::getResidentTile(int x, int z) const
+{
+    const Tile &tile = tiles[z * tilesX + x];
+    return tile.state == RESIDENT ? tile.data.get() : nullptr;
+}
+
+int TileStreamer::getPendingCount() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    int pending = int(uploadQueue.size() + loadQueue.size() + decoded.size());
+    for (size_t i = 0; i < tiles.size(); i++) {
+        if (tiles[i].state == LOADING)
+            pending++;
+    }
+    return pending;
+}
@@ -0,0 +1,168 @@
+/*
+ * Example of the OpenGL usage with SDL2
+ * Copyright (C) 2013 Matteo De Carlo <matteo.dek@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef SM_TILESTREAMER_H
+#define SM_TILESTREAMER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sm {
+
+class Camera;
+
+/**
+ * @brief Contents of a world tile, implemented by the game
+ *
+ * Decoded on a worker thread by the TileStreamer::Loader, then uploaded
+ * and released on the thread owning the OpenGL context.
+ */
+class StreamedTile
+{
+public:
+    virtual ~StreamedTile() {}
+
+    /**
+     * @brief Uploads a bounded part of the tile to the GPU
+     *
+     * Called once per frame until it returns true, keep every call short:
+     * the frame budget is checked between calls.
+     */
+    virtual bool upload() = 0;
+    /** Releases the GPU resources, the tile is deleted right after */
+    virtual void unload() = 0;
+
+    virtual size_t getCpuBytes() const = 0;
+    /** Bytes of GPU memory once uploaded */
+    virtual size_t getGpuBytes() const = 0;
+};
+
+/**
+ * @brief Keeps resident the world tiles around the camera, within a
+ * memory budget
+ *
+ * The world is a grid of square tiles on the XZ plane. Every frame
+ * update() wants the tiles closer than the load distance to the camera,
+ * and queues the missing ones for the worker threads, nearest first, tiles
+ * in the view frustum before the others. Decoded tiles are uploaded on the
+ * calling thread until the frame upload time budget is spent.
+ *
+ * When the decoded or uploaded tiles exceed the RAM or VRAM budget, the
+ * tiles seen least recently are evicted. Once the budget is reached only
+ * tiles in view are loaded, so that the others don't go back and forth.
+ * Tiles in view are never evicted: when only those are left, no more loads
+ * are started until memory frees.
+ */
+class TileStreamer
+{
+public:
+    /**
+     * Decodes tile (x, z), on a worker thread. Returns nullptr on failure,
+     * the tile is then not tried again until it leaves the load range
+     */
+    typedef std::function<StreamedTile*(int x, int z)> Loader;
+
+    TileStreamer(int tilesX, int tilesZ, float tileSize, const Loader &loader, int workerCount = 2);
+    ~TileStreamer();
+
+    void setLoadDistance(float distance) { loadDistance = distance; }
+    /** Seconds per frame spent in StreamedTile::upload() */
+    void setUploadBudget(double seconds) { uploadBudget = seconds; }
+    void setMemoryBudget(size_t ramBytes, size_t vramBytes) { ramBudget = ramBytes; vramBudget = vramBytes; }
+    /** Priority divisor of the tiles outside the frustum, the larger the later */
+    void setOutOfViewPenalty(float penalty) { outOfViewPenalty = penalty; }
+
+    /** Once per frame, on the thread owning the OpenGL context */
+    void update(Camera &camera);
+
+    /** The tile if uploaded, nullptr otherwise */
+    StreamedTile* getResidentTile(int x, int z) const;
+
+    size_t getCpuBytes() const { return cpuBytes; }
+    size_t getGpuBytes() const { return gpuBytes; }
+    int getResidentCount() const { return residentCount; }
+    int getPendingCount() const;
+    /** Time spent uploading in the last update() */
+    double getUploadSeconds() const { return uploadSeconds; }
+
+private:
+    enum State {
+        UNLOADED,
+        QUEUED,
+        LOADING,     // by a worker
+        DECODED,     // waiting for upload
+        UPLOADING,
+        RESIDENT,
+        FAILED       // by the loader, until out of the load range
+    };
+
+    struct Tile {
+        std::atomic<State> state;    // QUEUED -> LOADING set by the workers
+        std::unique_ptr<StreamedTile> data;
+        float priority;              // lower first
+        unsigned int lastVisible;    // frame
+        unsigned int lastWanted;
+    };
+
+    TileStreamer(const TileStreamer&);
+    TileStreamer& operator=(const TileStreamer&);
+
+    void workerLoop();
+    void uploadTiles();
+    void evict();
+    void release(int tile);
+
+    const int tilesX, tilesZ;
+    const float tileSize;
+    Loader loader;
+
+    float loadDistance;
+    double uploadBudget;
+    size_t ramBudget, vramBudget;
+    float outOfViewPenalty;
+
+    std::vector<Tile> tiles;
+    std::vector<int> uploadQueue;    // DECODED and UPLOADING tiles
+    std::vector<int> candidates;     // scratch of update()
+    std::vector<int> failed;         // FAILED tiles
+    unsigned int frame;
+    size_t cpuBytes, gpuBytes;
+    int residentCount;
+    double uploadSeconds;
+    bool overBudget;                 // nothing left to evict
+    int maxQueued;                   // loads queued per frame
+
+    // shared with the workers
+    mutable std::mutex mutex;
+    std::condition_variable queueCondition;
+    std::vector<int> loadQueue;      // QUEUED tiles, best last
+    std::vector<int> decoded;        // tiles just decoded, or failed
+    bool stopping;
+    std::vector<std::thread> workers;
+};
+
+}
+
+#endif // SM_TILESTREAMER_H
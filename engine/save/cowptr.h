@@ -0,0 +1,66 @@
+/*
+ * Example of the OpenGL usage with SDL2
+ * Copyright (C) 2013 Matteo De Carlo <matteo.dek@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef SM_COWPTR_H
+#define SM_COWPTR_H
+
+#include <cstdint>
+#include <memory>
+
+namespace sm {
+
+/**
+ * @brief Copy on write pointer to a piece of world state
+ *
+ * share() hands out a read only reference, e.g. to a save snapshot, at the
+ * cost of a pointer copy. The next write() then copies the value if the
+ * reference is still held, so the holder keeps seeing the state as it was
+ * when shared. The version counts the write() calls.
+ *
+ * Not thread safe: write() and share() must be called by the thread owning
+ * the state, the shared references can be read from any thread.
+ */
+template<class T>
+class CowPtr
+{
+public:
+    CowPtr() : pointer(std::make_shared<T>()), version(0) {}
+    explicit CowPtr(const T &value) : pointer(std::make_shared<T>(value)), version(0) {}
+
+    const T& read() const { return *pointer; }
+    const T* operator->() const { return pointer.get(); }
+
+    T& write() {
+        if (pointer.use_count() > 1)
+            pointer = std::make_shared<T>(*pointer);
+        version++;
+        return *pointer;
+    }
+
+    std::shared_ptr<const T> share() const { return pointer; }
+    uint64_t getVersion() const { return version; }
+
+private:
+    std::shared_ptr<T> pointer;
+    uint64_t version;
+};
+
+}
+
+#endif // SM_COWPTR_H
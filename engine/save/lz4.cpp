@@ -0,0 +1,180 @@
+/*
+ * Example of the OpenGL usage with SDL2
+ * Copyright (C) 2013 Matteo De Carlo <matteo.dek@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "lz4.h"
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+using namespace sm;
+
+namespace {
+    const size_t MIN_MATCH = 4;
+    const size_t LAST_LITERALS = 5;  // the block ends with at least 5 literals
+    const size_t MATCH_LIMIT = 12;   // no match starts in the last 12 bytes
+    const size_t MAX_OFFSET = 65535;
+    const int HASH_BITS = 12;
+
+    inline uint32_t read32(const unsigned char *p)
+    {
+        uint32_t value;
+        memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    inline uint32_t hashOf(uint32_t sequence)
+    {
+        return (sequence * 2654435761u) >> (32 - HASH_BITS);
+    }
+
+    /** Writes the 255 continuation bytes of a length over 15 */
+    inline unsigned char* writeLength(unsigned char *out, size_t length)
+    {
+        for (; length >= 255; length -= 255)
+            *out++ = 255;
+        *out++ = (unsigned char)length;
+        return out;
+    }
+}
+
+size_t Lz4::compress(const char *source, size_t size, char *destination, size_t capacity)
+{
+    if (capacity < compressBound(size))
+        return 0;
+
+    const unsigned char *in = reinterpret_cast<const unsigned char*>(source);
+    unsigned char *out = reinterpret_cast<unsigned char*>(destination);
+
+    // positions + 1, 0 for none
+    static thread_local std::vector<uint32_t> table;
+    table.assign(size_t(1) << HASH_BITS, 0);
+
+    size_t anchor = 0;
+    size_t position = 0;
+    while (size >= MATCH_LIMIT + 1 && position + MATCH_LIMIT < size) {
+        const uint32_t sequence = read32(in + position);
+        const uint32_t hash = hashOf(sequence);
+        const size_t candidate = table[hash];
+        table[hash] = uint32_t(position + 1);
+
+        if (candidate == 0 || position - (candidate - 1) > MAX_OFFSET || read32(in + candidate - 1) != sequence) {
+            // skip faster through data that doesn't compress
+            position += 1 + ((position - anchor) >> 6);
+            continue;
+        }
+
+        const size_t match = candidate - 1;
+        size_t length = MIN_MATCH;
+        while (position + length < size - LAST_LITERALS && in[match + length] == in[position + length])
+            length++;
+
+        const size_t literals = position - anchor;
+        unsigned char *token = out++;
+        *token = (unsigned char)((literals >= 15 ? 15 : literals) << 4);
+        if (literals >= 15)
+            out = writeLength(out, literals - 15);
+        memcpy(out, in + anchor, literals);
+        out += literals;
+
+        const size_t offset = position - match;
+        *out++ = (unsigned char)(offset & 0xFF);
+        *out++ = (unsigned char)(offset >> 8);
+        const size_t extra = length - MIN_MATCH;
+        *token |= (unsigned char)(extra >= 15 ? 15 : extra);
+        if (extra >= 15)
+            out = writeLength(out, extra - 15);
+
+        position += length;
+        anchor = position;
+    }
+
+    const size_t literals = size - anchor;
+    *out++ = (unsigned char)((literals >= 15 ? 15 : literals) << 4);
+    if (literals >= 15)
+        out = writeLength(out, literals - 15);
+    if (literals > 0)
+        memcpy(out, in + anchor, literals);
+    out += literals;
+
+    return size_t(out - reinterpret_cast<unsigned char*>(destination));
+}
+
+bool Lz4::decompress(const char *source, size_t size, char *destination, size_t rawSize)
+{
+    const unsigned char *in = reinterpret_cast<const unsigned char*>(source);
+    const unsigned char *end = in + size;
+    unsigned char *out = reinterpret_cast<unsigned char*>(destination);
+    size_t written = 0;
+
+    while (in < end) {
+        const unsigned char token = *in++;
+
+        size_t literals = token >> 4;
+        if (literals == 15) {
+            unsigned char byte;
+            do {
+                if (in >= end)
+                    return false;
+                byte = *in++;
+                literals += byte;
+            } while (byte == 255 && literals <= rawSize);
+        }
+        if (literals > size_t(end - in) || literals > rawSize - written)
+            return false;
+        memcpy(out + written, in, literals);
+        in += literals;
+        written += literals;
+
+        if (in == end)
+            break;  // the last sequence has no match
+
+        if (end - in < 2)
+            return false;
+        const size_t offset = size_t(in[0]) | (size_t(in[1]) << 8);
+        in += 2;
+        if (offset == 0 || offset > written)
+            return false;
+
+        size_t length = token & 15;
+        if (length == 15) {
+            unsigned char byte;
+            do {
+                if (in >= end)
+                    return false;
+                byte = *in++;
+                length += byte;
+            } while (byte == 255 && length <= rawSize);
+        }
+        length += MIN_MATCH;
+        if (length > rawSize - written)
+            return false;
+
+        // the match may overlap the bytes it produces
+        const unsigned char *match = out + written - offset;
+        if (offset >= length) {
+            memcpy(out + written, match, length);
+        } else {
+            for (size_t i = 0; i < length; i++)
+                out[written + i] = match[i];
+        }
+        written += length;
+    }
+
+    return written == rawSize;
+}
@@ -0,0 +1,64 @@
+/*
+ * Example of the OpenGL usage with SDL2
+ * Copyright (C) 2013 Matteo De Carlo <matteo.dek@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef SM_LZ4_H
+#define SM_LZ4_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace sm {
+
+/**
+ * @brief Compressor producing the LZ4 block format
+ *
+ * A compact greedy implementation: a single hash table of the last
+ * position of every 4 byte sequence, no chains. Blocks are readable by any
+ * LZ4 decoder and the other way round. Fast enough to be disk bound, for
+ * save games and caches.
+ */
+class Lz4
+{
+public:
+    /** Largest compressed size of "size" bytes */
+    static size_t compressBound(size_t size) { return size + size / 255 + 16; }
+    /** Largest decompressed size of a valid block of "size" bytes */
+    static uint64_t decompressBound(size_t size) { return uint64_t(size) * 255 + 16; }
+
+    /**
+     * @brief Compresses "size" bytes of "source" into "destination"
+     *
+     * @param capacity size of destination, at least compressBound(size)
+     * @return size_t compressed size, 0 if capacity is too small
+     */
+    static size_t compress(const char *source, size_t size, char *destination, size_t capacity);
+
+    /**
+     * @brief Decompresses a whole block, checking every bound
+     *
+     * @param rawSize size of the decompressed data, as stored by the caller
+     * @return bool false if the block is corrupted or doesn't decompress to
+     * exactly rawSize bytes
+     */
+    static bool decompress(const char *source, size_t size, char *destination, size_t rawSize);
+};
+
+}
+
+#endif // SM_LZ4_H
@@ -0,0 +1,371 @@
+/*
+ * Example of the OpenGL usage with SDL2
+ * Copyright (C) 2013 Matteo De Carlo <matteo.dek@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "savegame.h"
+#include "lz4.h"
+#include "../errorhandling.h"
+#include "../hash.h"
+#include "../jobs/jobsystem.h"
+#include "../timer.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+using namespace sm;
+
+namespace {
+    const char MAGIC[4] = { 'S', 'M', 'S', 'V' };
+    const uint32_t VERSION = 1;
+    const uint32_t CHUNK_RECORD = 0x4B4E4843;   // "CHNK"
+    const uint32_t COMMIT_RECORD = 0x54494D43;  // "CMIT"
+
+    struct FileHeader {
+        char     magic[4];
+        uint32_t version;
+    };
+
+    struct RecordHeader {
+        uint32_t type;
+        uint32_t size;          // bytes following the header
+    };
+
+    struct ChunkHeader {
+        uint32_t id;
+        uint32_t rawSize;
+        uint64_t checksum;      // of the compressed bytes
+    };
+
+    struct CommitHeader {
+        uint64_t saveNumber;
+        uint32_t count;
+        uint32_t reserved;
+    };
+
+    struct CommitEntry {
+        uint32_t id;
+        uint32_t recordSize;
+        uint64_t offset;
+    };
+    // followed by the checksum of header and entries
+
+    void append(std::vector<char> &out, const void *data, size_t size)
+    {
+        out.insert(out.end(), static_cast<const char*>(data), static_cast<const char*>(data) + size);
+    }
+
+    /** Reads the record at "offset", @return bool false if truncated */
+    bool readRecord(std::istream &stream, uint64_t offset, uint64_t fileSize, RecordHeader &header, std::vector<char> &payload)
+    {
+        if (offset + sizeof(RecordHeader) > fileSize)
+            return false;
+        stream.seekg(std::streamoff(offset));
+        if (!stream.read(reinterpret_cast<char*>(&header), sizeof(header)))
+            return false;
+        if (offset + sizeof(RecordHeader) + header.size > fileSize)
+            return false;
+        payload.resize(header.size);
+        return header.size == 0 || bool(stream.read(&payload[0], header.size));
+    }
+}
+
+SaveGame::SaveGame(const std::string &path, JobSystem *jobs)
+    : path(path), jobs(jobs), compactionRatio(2.0), appendOffset(0), tailCorrupted(false),
+      saveNumber(0), saving(false), lastResult(true), chunksWritten(0), bytesWritten(0),
+      saveSeconds(0), compacted(false)
+{
+}
+
+SaveGame::~SaveGame()
+{
+    wait();
+}
+
+bool SaveGame::wait()
+{
+    if (writer.joinable())
+        writer.join();
+    return lastResult;
+}
+
+bool SaveGame::load(const ChunkLoader &loader)
+{
+    wait();
+    index.clear();
+    appendOffset = 0;
+
+    std::ifstream stream(path.c_str(), std::ios_base::in | std::ios_base::binary);
+    if (!stream)
+        return false;
+    stream.seekg(0, std::ios_base::end);
+    const uint64_t fileSize = uint64_t(stream.tellg());
+    stream.seekg(0, std::ios_base::beg);
+
+    FileHeader fileHeader;
+    if (!stream.read(reinterpret_cast<char*>(&fileHeader), sizeof(fileHeader))
+            || memcmp(fileHeader.magic, MAGIC, sizeof(MAGIC)) != 0) {
+        emitError(path + " is not a save game");
+        return false;
+    }
+    if (fileHeader.version != VERSION) {
+        emitError(path + ": unsupported save game version");
+        return false;
+    }
+
+    // the last valid commit wins, a torn tail is ignored
+    uint64_t offset = sizeof(FileHeader);
+    RecordHeader header;
+    std::vector<char> payload;
+    while (readRecord(stream, offset, fileSize, header, payload)) {
+        const uint64_t next = offset + sizeof(RecordHeader) + header.size;
+        if (header.type == COMMIT_RECORD) {
+            if (payload.size() < sizeof(CommitHeader) + sizeof(uint64_t))
+                break;
+            CommitHeader commit;
+            memcpy(&commit, &payload[0], sizeof(commit));
+            const size_t entriesSize = size_t(commit.count) * sizeof(CommitEntry);
+            if (payload.size() != sizeof(CommitHeader) + entriesSize + sizeof(uint64_t))
+                break;
+            uint64_t checksum;
+            memcpy(&checksum, &payload[payload.size() - sizeof(checksum)], sizeof(checksum));
+            if (checksum != hashBytes(&payload[0], payload.size() - sizeof(checksum)))
+                break;
+
+            index.clear();
+            for (uint32_t i = 0; i < commit.count; i++) {
+                CommitEntry entry;
+                memcpy(&entry, &payload[sizeof(CommitHeader) + i * sizeof(CommitEntry)], sizeof(entry));
+                IndexEntry indexed = { entry.offset, entry.recordSize, 0 };
+                index[entry.id] = indexed;
+            }
+            saveNumber = commit.saveNumber;
+            appendOffset = next;
+        } else if (header.type != CHUNK_RECORD) {
+            break;
+        }
+        offset = next;
+    }
+    tailCorrupted = appendOffset != fileSize;
+
+    if (appendOffset == 0) {
+        emitError(path + ": no complete save found");
+        return false;
+    }
+
+    // in file order, for sequential reads
+    std::vector<std::pair<uint64_t, uint32_t> > order;
+    for (std::unordered_map<uint32_t, IndexEntry>::const_iterator it = index.begin(); it != index.end(); ++it)
+        order.push_back(std::make_pair(it->second.offset, it->first));
+    std::sort(order.begin(), order.end());
+
+    std::vector<char> raw;
+    for (size_t i = 0; i < order.size(); i++) {
+        ChunkHeader chunk;
+        if (!readRecord(stream, order[i].first, fileSize, header, payload) || header.type != CHUNK_RECORD
+                || payload.size() < sizeof(ChunkHeader)) {
+            emitError(path + ": missing save game chunk");
+            index.clear();
+            appendOffset = 0;
+            return false;
+        }
+        memcpy(&chunk, &payload[0], sizeof(chunk));
+        const char *compressed = &payload[0] + sizeof(ChunkHeader);
+        const size_t compressedSize = payload.size() - sizeof(ChunkHeader);
+        // rawSize isn't covered by the checksum, bounded before allocating
+        bool valid = chunk.id == order[i].second && chunk.rawSize <= Lz4::decompressBound(compressedSize)
+                  && hashBytes(compressed, compressedSize) == chunk.checksum;
+        if (valid) {
+            raw.resize(std::max<size_t>(chunk.rawSize, 1));
+            valid = Lz4::decompress(compressed, compressedSize, &raw[0], chunk.rawSize);
+        }
+        if (!valid) {
+            emitError(path + ": corrupted save game chunk");
+            index.clear();
+            appendOffset = 0;
+            return false;
+        }
+        loader(chunk.id, &raw[0], chunk.rawSize);
+    }
+    return true;
+}
+
+void SaveGame::save(const std::vector<SaveEntry> &snapshot)
+{
+    wait();
+    saving = true;
+    writer = std::thread([this, snapshot]() {
+        lastResult = write(snapshot);
+        saving = false;
+    });
+}
+
+bool SaveGame::write(const std::vector<SaveEntry> &snapshot)
+{
+    Timer timer;
+
+    // chunks changed since the last save
+    std::vector<size_t> dirty;
+    for (size_t i = 0; i < snapshot.size(); i++) {
+        std::unordered_map<uint32_t, IndexEntry>::const_iterator it = index.find(snapshot[i].id);
+        if (it == index.end() || it->second.version != snapshot[i].version)
+            dirty.push_back(i);
+    }
+
+    // serialized and compressed in parallel, as whole records
+    std::vector<std::vector<char> > records(dirty.size());
+    const auto encode = [&](int begin, int end) {
+        std::vector<char> raw;
+        for (int d = begin; d < end; d++) {
+            const SaveEntry &entry = snapshot[dirty[d]];
+            raw.clear();
+            entry.chunk->serialize(raw);
+
+            std::vector<char> &record = records[d];
+            const size_t headerSize = sizeof(RecordHeader) + sizeof(ChunkHeader);
+            record.resize(headerSize + Lz4::compressBound(raw.size()));
+            const size_t compressedSize = Lz4::compress(raw.empty() ? nullptr : &raw[0], raw.size(),
+                                                        &record[headerSize], record.size() - headerSize);
+            record.resize(headerSize + compressedSize);
+
+            RecordHeader header = { CHUNK_RECORD, uint32_t(sizeof(ChunkHeader) + compressedSize) };
+            ChunkHeader chunk = { entry.id, uint32_t(raw.size()), hashBytes(&record[headerSize], compressedSize) };
+            memcpy(&record[0], &header, sizeof(header));
+            memcpy(&record[sizeof(header)], &chunk, sizeof(chunk));
+        }
+    };
+    if (jobs != nullptr)
+        jobs->parallelFor(0, int(dirty.size()), encode, 1);
+    else
+        encode(0, int(dirty.size()));
+
+    uint64_t newBytes = 0, liveBytes = 0;
+    for (size_t d = 0; d < records.size(); d++)
+        newBytes += records[d].size();
+    liveBytes = newBytes;
+    for (size_t i = 0, d = 0; i < snapshot.size(); i++) {
+        if (d < dirty.size() && dirty[d] == i)
+            d++;
+        else
+            liveBytes += index[snapshot[i].id].recordSize;
+    }
+
+    const bool compact = appendOffset == 0 || tailCorrupted
+                      || double(appendOffset + newBytes) > compactionRatio * double(liveBytes + sizeof(FileHeader));
+    const std::string target = compact ? path + ".tmp" : path;
+
+    std::ifstream previous;
+    if (compact && appendOffset != 0)
+        previous.open(path.c_str(), std::ios_base::in | std::ios_base::binary);
+
+    std::fstream stream;
+    if (compact) {
+        stream.open(target.c_str(), std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+    } else {
+        stream.open(target.c_str(), std::ios_base::in | std::ios_base::out | std::ios_base::binary);
+        stream.seekp(std::streamoff(appendOffset));
+    }
+    if (!stream) {
+        emitError("could not write save game " + target);
+        return false;
+    }
+
+    // until the commit is written the tail is garbage
+    tailCorrupted = true;
+    uint64_t offset = compact ? 0 : appendOffset;
+    const uint64_t startOffset = offset;
+    if (compact) {
+        FileHeader fileHeader;
+        memcpy(fileHeader.magic, MAGIC, sizeof(MAGIC));
+        fileHeader.version = VERSION;
+        stream.write(reinterpret_cast<const char*>(&fileHeader), sizeof(fileHeader));
+        offset += sizeof(fileHeader);
+    }
+
+    std::unordered_map<uint32_t, IndexEntry> newIndex;
+    std::vector<char> commit(sizeof(CommitHeader));
+    std::vector<char> copy;
+    for (size_t i = 0, d = 0; i < snapshot.size(); i++) {
+        IndexEntry entry;
+        if (d < dirty.size() && dirty[d] == i) {
+            const std::vector<char> &record = records[d++];
+            stream.write(&record[0], record.size());
+            entry.offset = offset;
+            entry.recordSize = uint32_t(record.size());
+        } else if (compact) {
+            // unchanged, copied compressed
+            const IndexEntry &old = index[snapshot[i].id];
+            copy.resize(old.recordSize);
+            previous.seekg(std::streamoff(old.offset));
+            if (!previous.read(&copy[0], copy.size())) {
+                emitError("could not read save game " + path);
+                return false;
+            }
+            stream.write(&copy[0], copy.size());
+            entry.offset = offset;
+            entry.recordSize = old.recordSize;
+        } else {
+            entry = index[snapshot[i].id];
+        }
+        entry.version = snapshot[i].version;
+        if (entry.offset >= startOffset)
+            offset += entry.recordSize;
+        newIndex[snapshot[i].id] = entry;
+
+        CommitEntry listed = { snapshot[i].id, entry.recordSize, entry.offset };
+        append(commit, &listed, sizeof(listed));
+    }
+
+    CommitHeader commitHeader = { saveNumber + 1, uint32_t(snapshot.size()), 0 };
+    memcpy(&commit[0], &commitHeader, sizeof(commitHeader));
+    const uint64_t checksum = hashBytes(&commit[0], commit.size());
+    append(commit, &checksum, sizeof(checksum));
+    RecordHeader header = { COMMIT_RECORD, uint32_t(commit.size()) };
+    stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    stream.write(&commit[0], commit.size());
+    offset += sizeof(header) + commit.size();
+
+    stream.flush();
+    if (!stream) {
+        emitError("could not write save game " + target);
+        return false;
+    }
+    stream.close();
+    previous.close();
+
+    if (compact) {
+#ifdef WIN32
+        std::remove(path.c_str());
+#endif
+        if (std::rename(target.c_str(), path.c_str()) != 0) {
+            emitError("could not replace save game " + path);
+            return false;
+        }
+    }
+
+    index.swap(newIndex);
+    appendOffset = offset;
+    tailCorrupted = false;
+    saveNumber++;
+
+    chunksWritten = int(dirty.size());
+    bytesWritten = offset - startOffset;
+    compacted = compact;
+    saveSeconds = timer.getElapsedSeconds();
+    return true;
+}
@@ -0,0 +1,145 @@
+/*
+ * Example of the OpenGL usage with SDL2
+ * Copyright (C) 2013 Matteo De Carlo <matteo.dek@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef SM_SAVEGAME_H
+#define SM_SAVEGAME_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace sm {
+
+class JobSystem;
+
+/** @brief A piece of world state saved as a whole, e.g. a map region */
+class SaveChunk
+{
+public:
+    virtual ~SaveChunk() {}
+    /** Appends the chunk to "out", called on worker threads */
+    virtual void serialize(std::vector<char> &out) const = 0;
+};
+
+/**
+ * @brief A chunk as of the snapshot, usually from a CowPtr: share() and
+ * getVersion()
+ */
+struct SaveEntry
+{
+    uint32_t id;
+    uint64_t version;
+    std::shared_ptr<const SaveChunk> chunk;
+};
+
+/**
+ * @brief Incremental save game file
+ *
+ * The file is a log of records: LZ4 compressed chunks and commits, each
+ * commit listing where the chunks of a save are. A save appends only the
+ * chunks whose version changed since the last save, then a commit, so an
+ * interrupted save leaves the previous one readable. When the file grows
+ * past compactionRatio times the size of the chunks in use, the next save
+ * rewrites it from scratch, copying the unchanged chunks as they are.
+ *
+ * save() takes a snapshot, i.e. shared references to immutable chunks, and
+ * returns at once: chunks are serialized and compressed in parallel and
+ * written by a background thread while the simulation goes on, writing to
+ * its own copies (see CowPtr).
+ */
+class SaveGame
+{
+public:
+    typedef std::function<void(uint32_t id, const char *data, size_t size)> ChunkLoader;
+
+    explicit SaveGame(const std::string &path, JobSystem *jobs = nullptr);
+    /** Waits for the save in progress */
+    ~SaveGame();
+
+    /**
+     * @brief Reads the last complete save, calling "loader" for every chunk
+     *
+     * Loaded chunks count as saved at version 0, the version of a CowPtr
+     * built from the loaded data, so the next save only writes the chunks
+     * changed after loading.
+     *
+     * @return bool false if there is no readable save
+     */
+    bool load(const ChunkLoader &loader);
+
+    /**
+     * @brief Starts writing "snapshot", after waiting for the previous save
+     *
+     * Chunks not in the snapshot are dropped from the save.
+     */
+    void save(const std::vector<SaveEntry> &snapshot);
+
+    bool isSaving() const { return saving; }
+    /** Waits for the save in progress, @return bool false if it failed */
+    bool wait();
+
+    void setCompactionRatio(double ratio) { compactionRatio = ratio; }
+
+    /** Statistics of the last completed save */
+    int getChunksWritten() const { return chunksWritten; }
+    uint64_t getBytesWritten() const { return bytesWritten; }
+    double getSaveSeconds() const { return saveSeconds; }
+    bool wasCompacted() const { return compacted; }
+    uint64_t getFileSize() const { return appendOffset; }
+
+private:
+    struct IndexEntry {
+        uint64_t offset;
+        uint32_t recordSize;
+        uint64_t version;
+    };
+
+    SaveGame(const SaveGame&);
+    SaveGame& operator=(const SaveGame&);
+
+    bool write(const std::vector<SaveEntry> &snapshot);
+
+    std::string path;
+    JobSystem *jobs;
+    double compactionRatio;
+
+    // touched only by the writer thread while saving
+    std::unordered_map<uint32_t, IndexEntry> index;
+    uint64_t appendOffset;      // end of the last commit
+    bool tailCorrupted;         // bytes after the last commit
+    uint64_t saveNumber;
+
+    std::thread writer;
+    std::atomic<bool> saving;
+    bool lastResult;
+
+    int chunksWritten;
+    uint64_t bytesWritten;
+    double saveSeconds;
+    bool compacted;
+};
+
+}
+
+#endif // SM_SAVEGAME_H
@@ -18,67 +18,77 @@
  */
 
 #include "shader.h"
+#include "shadersource.h"
+#include "../errorhandling.h"
+#include "../timer.h"
 #include "GL/glew.h"
 #include <iostream>
+#include <iomanip>
 #include <fstream>
+#include <sstream>
 #include <cstdarg>
+#include <cstring>
+#ifdef WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
 
 using namespace sm;
 
-bool Shader::loadShaderFile(const char *szFile, GLuint shader)
-{
-    GLint shaderLength = 0;
-    std::ifstream shaderStream;
-    shaderStream.open(szFile, std::ios_base::in);
-    if (!shaderStream) {
-        shaderStream.close();
-        return false;
-    }
+namespace {
+    const char     BINARY_MAGIC[4] = { 'S', 'M', 'P', 'B' };
+    const uint32_t BINARY_VERSION = 1;
 
-    /*
-    while (shaderStream.get() != std::istream::traits_type::eof()) {
-        shaderLenght++;
-    }
+    /** Header of a program binary cache file, followed by the binary blob */
+    struct ProgramBinaryHeader {
+        char     magic[4];
+        uint32_t version;
+        smHash   key;
+        uint32_t format;
+        uint32_t length;
+    };
 
-    if(shaderLenght > MAX_SHADER_LENGTH) {
-        shaderStream.close();
-        return false;
+    const char* glString(GLenum name)
+    {
+        const GLubyte* value = glGetString(name);
+        return value != nullptr ? reinterpret_cast<const char*>(value) : "";
     }
+}
 
-    // Go back at the beginning of the file
-    shaderStream.seekg(1);
-    char *buffer = new char[shaderLenght+1];
-    //shaderStream.read(buffer,shaderLenght);
-    for (int i = 0; i<shaderLenght; i++){
-        buffer[i] = shaderStream.get();
-    }
-    buffer[shaderLenght] = '\0';
-    */
-    char buffer[MAX_SHADER_LENGTH];
-    char c;
-    while (true) {
-        c = shaderStream.get();
-        if (c == std::istream::traits_type::eof()) {
-            break;
-        }
-        shaderLength++;
-        if (shaderLength >= MAX_SHADER_LENGTH) {
-            shaderStream.close();
-            return false;
-        }
-        buffer[shaderLength-1]=c;
-    }
-    buffer[shaderLength]='\0';
+std::string Shader::binaryCacheDirectory;
+Shader::BuildStatistics Shader::buildStatistics = { 0, 0, 0.0, 0.0 };
+std::mutex Shader::statisticsMutex;
 
-    {
-        GLchar *stringArrayPtr[1];
-        stringArrayPtr[0] = (GLchar *)buffer;
-        glShaderSource(shader, 1, (const GLchar **)stringArrayPtr, NULL);
-    }
+void Shader::setBinaryCacheDirectory(const std::string &directory)
+{
+    binaryCacheDirectory = directory;
+    if (directory.empty())
+        return;
+#ifdef WIN32
+    _mkdir(directory.c_str());
+#else
+    mkdir(directory.c_str(), 0755);
+#endif
+}
 
-    shaderStream.close();
+Shader::BuildStatistics Shader::getBuildStatistics()
+{
+    std::lock_guard<std::mutex> lock(statisticsMutex);
+    return buildStatistics;
+}
 
-    return true;
+void Shader::reportBuildStatistics()
+{
+    BuildStatistics buildStatistics = getBuildStatistics();
+    std::cout<<"shaders compiled from source: "<<buildStatistics.cacheMisses
+             <<" in "<<buildStatistics.coldSeconds*1000.0<<" ms, loaded from binary cache: "
+             <<buildStatistics.cacheHits<<" in "<<buildStatistics.warmSeconds*1000.0<<" ms"<<std::endl;
+}
+
+bool Shader::loadShaderFile(const char *szFile, std::string &source)
+{
+    return ShaderSource::expandIncludes(szFile, source);
 }
 
 /**
@@ -87,6 +97,9 @@ bool Shader::loadShaderFile(const char *szFile, GLuint shader)
  * specify the number of attributes, followed by the index and attribute name
  * of each attribute
  *
+ * If a binary cache directory is set, the linked program is looked up there
+ * first and compiled from source only if missing or stale.
+ *
  * @param vertexShaderFilename Path to vertex shader source code
  * @param fragmentShaderFilename Path to the fragment shader source code
  * 
@@ -94,170 +107,622 @@ bool Shader::loadShaderFile(const char *szFile, GLuint shader)
  */
 Shader::Shader(const char* vertexShaderFilename, const char* fragmentShaderFilename, ...)
 {
-    // Temporary Shader objects
-    GLuint hVertexShader;
-    GLuint hFragmentShader;
-    GLint testVal;
-    char *log;
-    goto begin;
-
-VertexErrorExit:
-    glGetShaderiv(hVertexShader, GL_INFO_LOG_LENGTH, &testVal);
-    log = new char[testVal+1];
-    glGetShaderInfoLog(hVertexShader, testVal+1, &testVal, log);
-    log[testVal] = '\0';
-    std::cerr<<"#ERROR: Vertex shader Log:\n"<<log<<std::endl;
-    delete[] log;
-    glDeleteShader(hVertexShader);
-    goto errorExit;
-
-FragmentErrorExit:
-    glGetShaderiv(hFragmentShader, GL_INFO_LOG_LENGTH, &testVal);
-    log = new char[testVal+1];
-    glGetShaderInfoLog(hFragmentShader, testVal+1, &testVal, log);
-    log[testVal] = '\0';
-    std::cerr<<"#ERROR: Fragment shader Log:\n"<<log<<std::endl;
-    delete[] log;
-    glDeleteShader(hFragmentShader);
-
-errorExit:
     this->statusValue = false;
-    return;
-
-    
-begin:
-    // Create Shader objects
-    std::cerr<<"glCreateShader:"<<glCreateShader<<std::endl;
-    hVertexShader = glCreateShader(GL_VERTEX_SHADER);
-    hFragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-
-    // Load them
-    if (loadShaderFile(vertexShaderFilename, hVertexShader) == false) {
-        goto errorExit;
-    }
-    if (loadShaderFile(fragmentShaderFilename, hFragmentShader) == false) {
-        goto errorExit;
-    }
-
-    // Compile them
-    glCompileShader(hVertexShader);
-    glCompileShader(hFragmentShader);
-
-
-    // Check for errors
-    glGetShaderiv(hVertexShader, GL_COMPILE_STATUS, &testVal);
-    if(testVal == GL_FALSE)     {
-        goto VertexErrorExit;
-    }
-    glGetShaderiv(hFragmentShader, GL_COMPILE_STATUS, &testVal);
-    if(testVal == GL_FALSE)     {
-        goto FragmentErrorExit;
-    }
-
-    this->shaderPointer = glCreateProgram();
-    glAttachShader(shaderPointer,hVertexShader);
-    glAttachShader(shaderPointer,hFragmentShader);
-
+    this->shaderPointer = 0;
+    this->fromBinaryCache = false;
+    this->buildSeconds = 0.0;
+    this->pendingVertexShader = 0;
+    this->pendingFragmentShader = 0;
+    this->pendingKey = 0;
+    this->skippedUploads = 0;
+    this->uploads = 0;
 
     // List of attributes
     va_list attributeList;
     va_start (attributeList, fragmentShaderFilename);
 
-    char *szNextArg;
+    AttributeBindings bindings;
     int iArgCount = va_arg(attributeList, int); // Number of attributes
     for(int i = 0; i < iArgCount; i++)
     {
-        int index = va_arg(attributeList, int);
-        szNextArg = va_arg(attributeList, char*);
-        glBindAttribLocation(shaderPointer, index, szNextArg);
+        AttributeBinding binding;
+        binding.index = va_arg(attributeList, int);
+        binding.name = va_arg(attributeList, char*);
+        bindings.push_back(binding);
     }
 
     va_end(attributeList);
 
+    std::string vertexSource, fragmentSource;
+    if (loadShaderFile(vertexShaderFilename, vertexSource) == false) {
+        std::cerr<<"#ERROR: could not load vertex shader "<<vertexShaderFilename<<std::endl;
+        return;
+    }
+    if (loadShaderFile(fragmentShaderFilename, fragmentSource) == false) {
+        std::cerr<<"#ERROR: could not load fragment shader "<<fragmentShaderFilename<<std::endl;
+        return;
+    }
+
+    this->build(vertexSource, fragmentSource, bindings);
+}
+
+Shader::~Shader()
+{
+    if (shaderPointer != 0)
+        glDeleteProgram(shaderPointer);
+}
+
+/**
+ * Builds a program from already loaded sources, synchronously.
+ */
+Shader::Shader(const std::string &vertexSource, const std::string &fragmentSource, const AttributeBindings &bindings)
+{
+    this->statusValue = false;
+    this->shaderPointer = 0;
+    this->fromBinaryCache = false;
+    this->buildSeconds = 0.0;
+    this->pendingVertexShader = 0;
+    this->pendingFragmentShader = 0;
+    this->pendingKey = 0;
+    this->skippedUploads = 0;
+    this->uploads = 0;
+
+    this->build(vertexSource, fragmentSource, bindings);
+}
+
+/**
+ * Empty shader, for ShaderCompiler to drive beginBuild()/endBuild()
+ */
+Shader::Shader()
+{
+    this->statusValue = false;
+    this->shaderPointer = 0;
+    this->fromBinaryCache = false;
+    this->buildSeconds = 0.0;
+    this->pendingVertexShader = 0;
+    this->pendingFragmentShader = 0;
+    this->pendingKey = 0;
+    this->skippedUploads = 0;
+    this->uploads = 0;
+}
+
+void Shader::build(const std::string &vertexSource, const std::string &fragmentSource, const AttributeBindings &bindings)
+{
+    this->beginBuild(vertexSource, fragmentSource, bindings);
+    this->endBuild();
+}
+
+/**
+ * First half of the build: loads the program from the binary cache, or
+ * submits compilation and linking to the driver without waiting for the
+ * result. With GL_KHR_parallel_shader_compile the driver works on it in
+ * background until endBuild() asks for the status.
+ */
+void Shader::beginBuild(const std::string &vertexSource, const std::string &fragmentSource, const AttributeBindings &bindings)
+{
+    buildTimer.reset();
+    this->pendingVertexShader = 0;
+    this->pendingFragmentShader = 0;
+    this->pendingKey = programKey(vertexSource, fragmentSource, bindings);
+
+    if (loadProgramBinary(pendingKey)) {
+        this->fromBinaryCache = true;
+        return;
+    }
+
+    pendingVertexShader = submitShader(GL_VERTEX_SHADER, vertexSource);
+    pendingFragmentShader = submitShader(GL_FRAGMENT_SHADER, fragmentSource);
+
+    this->shaderPointer = glCreateProgram();
+    glAttachShader(shaderPointer,pendingVertexShader);
+    glAttachShader(shaderPointer,pendingFragmentShader);
+
+    for (AttributeBindings::const_iterator it = bindings.begin(); it != bindings.end(); ++it)
+        glBindAttribLocation(shaderPointer, it->index, it->name.c_str());
+
+    if (binaryCacheAvailable())
+        glProgramParameteri(shaderPointer, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
     // Link the shader program
     glLinkProgram(shaderPointer);
+}
+
+/**
+ * @return bool true if endBuild() would not block waiting for the driver
+ */
+bool Shader::isBuildComplete() const
+{
+    if (fromBinaryCache || shaderPointer == 0 || !parallelCompileAvailable())
+        return true;
+
+    GLint completed = GL_FALSE;
+    glGetProgramiv(shaderPointer, GL_COMPLETION_STATUS_KHR, &completed);
+    return completed == GL_TRUE;
+}
+
+/**
+ * Second half of the build: checks compile and link status, reflects the
+ * program and stores it in the binary cache.
+ */
+void Shader::endBuild()
+{
+    if (!fromBinaryCache) {
+        bool compiled = checkShader(pendingVertexShader, "Vertex");
+        compiled = checkShader(pendingFragmentShader, "Fragment") && compiled;
+
+        // These are no longer needed
+        glDeleteShader(pendingVertexShader);
+        glDeleteShader(pendingFragmentShader);
+        pendingVertexShader = 0;
+        pendingFragmentShader = 0;
+
+        if (!compiled || !checkProgram()) {
+            glDeleteProgram(shaderPointer);
+            shaderPointer = 0;
+            this->statusValue = false;
+            return;
+        }
+
+        saveProgramBinary(pendingKey);
+    }
+
+    this->reflectProgram();
+    this->statusValue = true;
+    this->buildSeconds = buildTimer.getElapsedSeconds();
+
+    std::lock_guard<std::mutex> lock(statisticsMutex);
+    if (fromBinaryCache) {
+        buildStatistics.cacheHits++;
+        buildStatistics.warmSeconds += buildSeconds;
+    } else {
+        buildStatistics.cacheMisses++;
+        buildStatistics.coldSeconds += buildSeconds;
+    }
+}
+
+GLuint Shader::submitShader(GLenum type, const std::string &source)
+{
+    GLuint shader = glCreateShader(type);
+    const GLchar *sourcePtr = source.c_str();
+    GLint length = GLint(source.size());
+    glShaderSource(shader, 1, &sourcePtr, &length);
+    glCompileShader(shader);
+    return shader;
+}
+
+/**
+ * Checks the compile status of a single shader stage, printing the info
+ * log on failure.
+ */
+bool Shader::checkShader(GLuint shader, const char *stageName)
+{
+    GLint testVal;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &testVal);
+    if (testVal == GL_FALSE) {
+        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &testVal);
+        char *log = new char[testVal+1];
+        glGetShaderInfoLog(shader, testVal+1, &testVal, log);
+        log[testVal] = '\0';
+        std::cerr<<"#ERROR: "<<stageName<<" shader Log:\n"<<log<<std::endl;
+        delete[] log;
+        return false;
+    }
 
-    // These are no longer needed
-    glDeleteShader(hVertexShader);
-    glDeleteShader(hFragmentShader);
+    return true;
+}
 
+bool Shader::checkProgram()
+{
     // Make sure the link worked
+    GLint testVal;
     glGetProgramiv(shaderPointer, GL_LINK_STATUS, &testVal);
     if (testVal == GL_FALSE) {
         glGetProgramiv(shaderPointer, GL_INFO_LOG_LENGTH, &testVal);
-        log = new char[testVal+1];
-        glGetShaderInfoLog(shaderPointer, testVal+1, &testVal, log);
+        char *log = new char[testVal+1];
+        glGetProgramInfoLog(shaderPointer, testVal+1, &testVal, log);
         log[testVal] = '\0';
         std::cerr<<"#ERROR: Shader Program Linking :\n"<<log<<std::endl;
         delete[] log;
+        return false;
+    }
+
+    return true;
+}
+
+bool Shader::parallelCompileAvailable()
+{
+    return GLEW_KHR_parallel_shader_compile || GLEW_ARB_parallel_shader_compile;
+}
+
+bool Shader::binaryCacheAvailable()
+{
+    if (binaryCacheDirectory.empty() || !GLEW_ARB_get_program_binary)
+        return false;
+
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    return formats > 0;
+}
+
+/**
+ * Key of the program in the binary cache: sources, attribute bindings and
+ * the driver identification, so that a driver update invalidates the cache.
+ */
+smHash Shader::programKey(const std::string &vertexSource, const std::string &fragmentSource, const AttributeBindings &bindings)
+{
+    smHash key = hashString(vertexSource);
+    key = hashString(fragmentSource, key);
+    for (AttributeBindings::const_iterator it = bindings.begin(); it != bindings.end(); ++it) {
+        key = hashBytes(&it->index, sizeof(it->index), key);
+        key = hashString(it->name, key);
+    }
+    key = hashString(glString(GL_VENDOR), key);
+    key = hashString(glString(GL_RENDERER), key);
+    key = hashString(glString(GL_VERSION), key);
+    return key;
+}
+
+std::string Shader::binaryCachePath(smHash key)
+{
+    std::stringstream path;
+    path<<binaryCacheDirectory<<'/'<<std::hex<<std::setw(16)<<std::setfill('0')<<key<<".bin";
+    return path.str();
+}
+
+/**
+ * Tries to create the program from the binary cache. Any mismatch in the
+ * file, or the driver refusing the binary, makes the cache entry stale.
+ */
+bool Shader::loadProgramBinary(smHash key)
+{
+    if (!binaryCacheAvailable())
+        return false;
+
+    std::ifstream file(binaryCachePath(key).c_str(), std::ios_base::in | std::ios_base::binary);
+    if (!file)
+        return false;
+
+    ProgramBinaryHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+        return false;
+    if (memcmp(header.magic, BINARY_MAGIC, sizeof(BINARY_MAGIC)) != 0
+        || header.version != BINARY_VERSION
+        || header.key != key
+        || header.length == 0)
+        return false;
+
+    std::vector<char> binary(header.length);
+    if (!file.read(binary.data(), header.length))
+        return false;
+
+    this->shaderPointer = glCreateProgram();
+    glProgramBinary(shaderPointer, header.format, binary.data(), header.length);
+
+    GLint testVal;
+    glGetProgramiv(shaderPointer, GL_LINK_STATUS, &testVal);
+    if (testVal == GL_FALSE) {
         glDeleteProgram(shaderPointer);
-        goto errorExit;
+        shaderPointer = 0;
+        return false;
     }
 
-    this->statusValue = true;
-    return;
+    return true;
+}
+
+void Shader::saveProgramBinary(smHash key)
+{
+    if (!binaryCacheAvailable())
+        return;
+
+    GLint length = 0;
+    glGetProgramiv(shaderPointer, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+
+    ProgramBinaryHeader header;
+    memcpy(header.magic, BINARY_MAGIC, sizeof(BINARY_MAGIC));
+    header.version = BINARY_VERSION;
+    header.key = key;
+
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    glGetProgramBinary(shaderPointer, length, &length, &format, binary.data());
+    header.format = format;
+    header.length = length;
+
+    std::ofstream file(binaryCachePath(key).c_str(), std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+    if (!file) {
+        emitError("could not write the shader binary cache in " + binaryCacheDirectory);
+        return;
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(binary.data(), length);
+}
+
+/**
+ * Reads all the active uniforms, uniform blocks and attributes of the linked
+ * program into the flat reflection tables, so that no further query to the
+ * driver is needed to find a location.
+ */
+void Shader::reflectProgram()
+{
+    GLint count = 0, maxLength = 0;
+
+    // Uniforms
+    size_t shadowSize = 0;
+    glGetProgramiv(shaderPointer, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(shaderPointer, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+    std::vector<GLchar> name(maxLength + 1);
+    uniforms.reserve(count);
+    for (GLint i = 0; i < count; i++) {
+        UniformInfo info;
+        GLsizei length = 0;
+        glGetActiveUniform(shaderPointer, i, maxLength + 1, &length, &info.size, &info.type, name.data());
+        info.name.assign(name.data(), length);
+        info.location = glGetUniformLocation(shaderPointer, info.name.c_str());
+        GLuint uniformIndex = i;
+        glGetActiveUniformsiv(shaderPointer, 1, &uniformIndex, GL_UNIFORM_BLOCK_INDEX, &info.blockIndex);
+
+        // room for the shadow copy of the first element, set by Uniform()
+        info.shadowOffset = GLint(shadowSize);
+        info.shadowSize = info.location != -1 ? uniformTypeSize(info.type) : 0;
+        info.shadowValid = false;
+        shadowSize += info.shadowSize;
+
+        // arrays are reported as "name[0]": make them reachable as "name" too
+        int index = int(uniforms.size());
+        uniformNames[info.name] = index;
+        std::string::size_type bracket = info.name.rfind("[0]");
+        if (bracket != std::string::npos && bracket + 3 == info.name.size())
+            uniformNames[info.name.substr(0, bracket)] = index;
+
+        uniforms.push_back(info);
+    }
+    shadowValues.assign(shadowSize, 0);
+
+    // Uniform blocks
+    glGetProgramiv(shaderPointer, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+    uniformBlocks.reserve(count);
+    for (GLint i = 0; i < count; i++) {
+        UniformBlockInfo info;
+        GLint length = 0;
+        glGetActiveUniformBlockiv(shaderPointer, i, GL_UNIFORM_BLOCK_NAME_LENGTH, &length);
+        name.resize(length + 1);
+        glGetActiveUniformBlockName(shaderPointer, i, length + 1, &length, name.data());
+        info.name.assign(name.data(), length);
+        info.index = i;
+        glGetActiveUniformBlockiv(shaderPointer, i, GL_UNIFORM_BLOCK_DATA_SIZE, &info.dataSize);
+        glGetActiveUniformBlockiv(shaderPointer, i, GL_UNIFORM_BLOCK_BINDING, &info.binding);
+
+        uniformBlockNames[info.name] = int(uniformBlocks.size());
+        uniformBlocks.push_back(info);
+    }
+
+    // Attributes
+    glGetProgramiv(shaderPointer, GL_ACTIVE_ATTRIBUTES, &count);
+    glGetProgramiv(shaderPointer, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &maxLength);
+    name.resize(maxLength + 1);
+    attributes.reserve(count);
+    for (GLint i = 0; i < count; i++) {
+        AttributeInfo info;
+        GLsizei length = 0;
+        glGetActiveAttrib(shaderPointer, i, maxLength + 1, &length, &info.size, &info.type, name.data());
+        info.name.assign(name.data(), length);
+        info.location = glGetAttribLocation(shaderPointer, info.name.c_str());
+
+        attributeNames[info.name] = int(attributes.size());
+        attributes.push_back(info);
+    }
+}
+
+/**
+ * Size in bytes of a single element of a uniform of GLSL type "type"
+ */
+GLint Shader::uniformTypeSize(GLenum type)
+{
+    switch (type) {
+    case GL_FLOAT:              return 1 * sizeof(GLfloat);
+    case GL_FLOAT_VEC2:         return 2 * sizeof(GLfloat);
+    case GL_FLOAT_VEC3:         return 3 * sizeof(GLfloat);
+    case GL_FLOAT_VEC4:         return 4 * sizeof(GLfloat);
+    case GL_INT_VEC2:
+    case GL_BOOL_VEC2:          return 2 * sizeof(GLint);
+    case GL_INT_VEC3:
+    case GL_BOOL_VEC3:          return 3 * sizeof(GLint);
+    case GL_INT_VEC4:
+    case GL_BOOL_VEC4:          return 4 * sizeof(GLint);
+    case GL_UNSIGNED_INT_VEC2:  return 2 * sizeof(GLuint);
+    case GL_UNSIGNED_INT_VEC3:  return 3 * sizeof(GLuint);
+    case GL_UNSIGNED_INT_VEC4:  return 4 * sizeof(GLuint);
+    case GL_FLOAT_MAT2:         return 4 * sizeof(GLfloat);
+    case GL_FLOAT_MAT3:         return 9 * sizeof(GLfloat);
+    case GL_FLOAT_MAT4:         return 16 * sizeof(GLfloat);
+    case GL_FLOAT_MAT2x3:
+    case GL_FLOAT_MAT3x2:       return 6 * sizeof(GLfloat);
+    case GL_FLOAT_MAT2x4:
+    case GL_FLOAT_MAT4x2:       return 8 * sizeof(GLfloat);
+    case GL_FLOAT_MAT3x4:
+    case GL_FLOAT_MAT4x3:       return 12 * sizeof(GLfloat);
+    default:                    return sizeof(GLint); // int, bool, uint and samplers
+    }
+}
+
+int Shader::findUniform(const char* name) const
+{
+    NameTable::const_iterator it = uniformNames.find(name);
+    if (it == uniformNames.end())
+        return -1;
+    return it->second;
+}
+
+/**
+ * true if "data" differs from the value last uploaded to uniform "index",
+ * which becomes the new shadow copy. Values larger than the shadow copy
+ * (a type mismatch) are uploaded without being remembered.
+ */
+bool Shader::shadowChanged(int index, const void *data, size_t size)
+{
+    if (index < 0)
+        return false;
+    UniformInfo &info = uniforms[index];
+    if (info.location == -1)
+        return false;
+
+    if (size > size_t(info.shadowSize)) {
+        info.shadowValid = false;
+        uploads++;
+        return true;
+    }
+
+    unsigned char *shadow = &shadowValues[info.shadowOffset];
+    if (info.shadowValid && memcmp(shadow, data, size) == 0) {
+        skippedUploads++;
+        return false;
+    }
+    memcpy(shadow, data, size);
+    info.shadowValid = true;
+    uploads++;
+    return true;
+}
+
+void Shader::invalidateShadowState()
+{
+    for (size_t i = 0; i < uniforms.size(); i++)
+        uniforms[i].shadowValid = false;
+    std::fill(shadowValues.begin(), shadowValues.end(), 0);
+}
+
+void Shader::reportTypeMismatch(const char* name) const
+{
+    std::stringstream message;
+    message<<"uniform \""<<name<<"\" requested with a type different from its GLSL declaration";
+    emitError(message.str());
+}
+
+GLint Shader::getUniformLocation(const char* name) const
+{
+    int index = findUniform(name);
+    if (index < 0)
+        return -1;
+    return uniforms[index].location;
+}
+
+GLuint Shader::getUniformBlockIndex(const char* name) const
+{
+    NameTable::const_iterator it = uniformBlockNames.find(name);
+    if (it == uniformBlockNames.end())
+        return GL_INVALID_INDEX;
+    return uniformBlocks[it->second].index;
+}
+
+GLint Shader::getAttributeLocation(const char* name) const
+{
+    NameTable::const_iterator it = attributeNames.find(name);
+    if (it == attributeNames.end())
+        return -1;
+    return attributes[it->second].location;
 }
 
 void Shader::Uniform(const char* name, int arg1)
 {
-    GLint uniformLoc = glGetUniformLocation(shaderPointer,name);
-    //this->use();
-    glUniform1i(uniformLoc, arg1);
+    int index = findUniform(name);
+    const GLint values[] = { arg1 };
+    if (shadowChanged(index, values, sizeof(values)))
+        glUniform1i(uniforms[index].location, arg1);
 }
 void Shader::Uniform(const char* name, int arg1, int arg2)
 {
-    GLint uniformLoc = glGetUniformLocation(shaderPointer,name);
-    //this->use();
-    glUniform2i(uniformLoc, arg1, arg2);
+    int index = findUniform(name);
+    const GLint values[] = { arg1, arg2 };
+    if (shadowChanged(index, values, sizeof(values)))
+        glUniform2i(uniforms[index].location, arg1, arg2);
 }
 void Shader::Uniform(const char* name, int arg1, int arg2, int arg3)
 {
-    GLint uniformLoc = glGetUniformLocation(shaderPointer,name);
-    //this->use();
-    glUniform3i(uniformLoc, arg1, arg2, arg3);
+    int index = findUniform(name);
+    const GLint values[] = { arg1, arg2, arg3 };
+    if (shadowChanged(index, values, sizeof(values)))
+        glUniform3i(uniforms[index].location, arg1, arg2, arg3);
 }
 void Shader::Uniform(const char* name, int arg1, int arg2, int arg3, int arg4)
 {
-    GLint uniformLoc = glGetUniformLocation(shaderPointer,name);
-    //this->use();
-    glUniform4i(uniformLoc, arg1, arg2, arg3, arg4);
+    int index = findUniform(name);
+    const GLint values[] = { arg1, arg2, arg3, arg4 };
+    if (shadowChanged(index, values, sizeof(values)))
+        glUniform4i(uniforms[index].location, arg1, arg2, arg3, arg4);
 }
 
 //UNIFORM FLOAT
 void Shader::Uniform(const char* name, float arg1)
 {
-    GLint uniformLoc = glGetUniformLocation(shaderPointer,name);
-    //this->use();
-    glUniform1f(uniformLoc, arg1);
+    int index = findUniform(name);
+    const GLfloat values[] = { arg1 };
+    if (shadowChanged(index, values, sizeof(values)))
+        glUniform1f(uniforms[index].location, arg1);
 }
 void Shader::Uniform(const char* name, float arg1, float arg2)
 {
-    GLint uniformLoc = glGetUniformLocation(shaderPointer,name);
-    //this->use();
-    glUniform2f(uniformLoc, arg1, arg2);
+    int index = findUniform(name);
+    const GLfloat values[] = { arg1, arg2 };
+    if (shadowChanged(index, values, sizeof(values)))
+        glUniform2f(uniforms[index].location, arg1, arg2);
 }
 void Shader::Uniform(const char* name, float arg1, float arg2, float arg3)
 {
-    GLint uniformLoc = glGetUniformLocation(shaderPointer,name);
-    //this->use();
-    glUniform3f(uniformLoc, arg1, arg2, arg3);
+    int index = findUniform(name);
+    const GLfloat values[] = { arg1, arg2, arg3 };
+    if (shadowChanged(index, values, sizeof(values)))
+        glUniform3f(uniforms[index].location, arg1, arg2, arg3);
 }
 void Shader::Uniform(const char* name, float arg1, float arg2, float arg3, float arg4)
 {
-    GLint uniformLoc = glGetUniformLocation(shaderPointer,name);
-    //this->use();
-    glUniform4f(uniformLoc, arg1, arg2, arg3, arg4);
+    int index = findUniform(name);
+    const GLfloat values[] = { arg1, arg2, arg3, arg4 };
+    if (shadowChanged(index, values, sizeof(values)))
+        glUniform4f(uniforms[index].location, arg1, arg2, arg3, arg4);
 }
 
 void Shader::UniformMatrix33(const char* name, const Matrix33& matrix)
 {
-    GLint uniformLoc = glGetUniformLocation(shaderPointer,name);
-    //this->use();
-    glUniformMatrix4fv(uniformLoc, 1, GL_FALSE, matrix.data());
+    int index = findUniform(name);
+    if (shadowChanged(index, matrix.data(), sizeof(smReal) * 9))
+        glUniformMatrix3fv(uniforms[index].location, 1, GL_FALSE, matrix.data());
 }
 void Shader::UniformMatrix44(const char* name, const Matrix44& matrix)
 {
-    GLint uniformLoc = glGetUniformLocation(shaderPointer,name);
-    //this->use();
-    glUniformMatrix3fv(uniformLoc, 1, GL_FALSE, matrix.data());
+    int index = findUniform(name);
+    if (shadowChanged(index, matrix.data(), sizeof(smReal) * 16))
+        glUniformMatrix4fv(uniforms[index].location, 1, GL_FALSE, matrix.data());
+}
+
+//UNIFORM BY HANDLE
+void Shader::Uniform(const UniformHandle<int>& handle, const int value)
+{
+    if (shadowChanged(handle.index, &value, sizeof(value)))
+        glUniform1i(handle.location, value);
+}
+void Shader::Uniform(const UniformHandle<smReal>& handle, const smReal value)
+{
+    if (shadowChanged(handle.index, &value, sizeof(value)))
+        glUniform1f(handle.location, value);
+}
+void Shader::Uniform(const UniformHandle<Vector3>& handle, const Vector3& value)
+{
+    if (shadowChanged(handle.index, value.data(), sizeof(smReal) * 3))
+        glUniform3fv(handle.location, 1, value.data());
+}
+void Shader::Uniform(const UniformHandle<Vector4>& handle, const Vector4& value)
+{
+    if (shadowChanged(handle.index, value.data(), sizeof(smReal) * 4))
+        glUniform4fv(handle.location, 1, value.data());
+}
+void Shader::Uniform(const UniformHandle<Matrix33>& handle, const Matrix33& matrix)
+{
+    if (shadowChanged(handle.index, matrix.data(), sizeof(smReal) * 9))
+        glUniformMatrix3fv(handle.location, 1, GL_FALSE, matrix.data());
+}
+void Shader::Uniform(const UniformHandle<Matrix44>& handle, const Matrix44& matrix)
+{
+    if (shadowChanged(handle.index, matrix.data(), sizeof(smReal) * 16))
+        glUniformMatrix4fv(handle.location, 1, GL_FALSE, matrix.data());
 }
@@ -21,12 +21,21 @@
 #define SM_SHADER_H
 
 #include "../math/math.h"
+#include "../hash.h"
+#include "../timer.h"
+#include "uniformhandle.h"
 #include "GL/glew.h"
+#include <mutex>
+#include <string>
+#include <vector>
+#include <unordered_map>
 
 namespace sm {
 
 class Shader
 {
+    friend class ShaderCompiler;
+    friend class ShaderFuture;
 public:
     enum ATTRIBUTE {
         ATTRIBUTE_VERTEX  = 0,
@@ -46,10 +55,58 @@ public:
         ATTRIBUTE_14 = 14,
         ATTRIBUTE_15 = 15
     };
-    
-    static const int MAX_SHADER_LENGTH = 8192;
+
+    /** Explicit binding of a vertex attribute name to an ATTRIBUTE slot */
+    struct AttributeBinding {
+        GLuint      index;
+        std::string name;
+    };
+    typedef std::vector<AttributeBinding> AttributeBindings;
+
+    /**
+     * Cumulated build times of all the shaders, split between programs
+     * compiled from source (cold) and loaded from the binary cache (warm)
+     */
+    struct BuildStatistics {
+        int     cacheHits;
+        int     cacheMisses;
+        smRealD warmSeconds;
+        smRealD coldSeconds;
+    };
+
+    /** Reflected active uniform. Uniforms inside a block have location -1 */
+    struct UniformInfo {
+        std::string name;
+        GLenum      type;
+        GLint       size;       // number of array elements
+        GLint       location;
+        GLint       blockIndex; // -1 if in the default block
+
+        // last value uploaded through this Shader
+        GLint       shadowOffset;
+        GLint       shadowSize;
+        bool        shadowValid;
+    };
+
+    /** Reflected active uniform block */
+    struct UniformBlockInfo {
+        std::string name;
+        GLuint      index;
+        GLint       dataSize;
+        GLint       binding;
+    };
+
+    /** Reflected active vertex attribute */
+    struct AttributeInfo {
+        std::string name;
+        GLenum      type;
+        GLint       size;
+        GLint       location;
+    };
 
     Shader(const char *vertexShaderFilename, const char *fragmentShaderFilename, ...);
+    Shader(const std::string &vertexSource, const std::string &fragmentSource, const AttributeBindings &bindings);
+    ~Shader();
 
     //UNIFORM INTEGER
     void Uniform(const char* name, const int arg1);
@@ -65,15 +122,143 @@ public:
     void UniformMatrix44(const char *name, const Matrix44 &matrix);
     void UniformMatrix33(const char *name, const Matrix33 &matrix);
 
+    //UNIFORM BY HANDLE
+    void Uniform(const UniformHandle<int> &handle, const int value);
+    void Uniform(const UniformHandle<smReal> &handle, const smReal value);
+    void Uniform(const UniformHandle<Vector3> &handle, const Vector3 &value);
+    void Uniform(const UniformHandle<Vector4> &handle, const Vector4 &value);
+    void Uniform(const UniformHandle<Matrix33> &handle, const Matrix33 &matrix);
+    void Uniform(const UniformHandle<Matrix44> &handle, const Matrix44 &matrix);
+
+    /**
+     * @brief Gets a typed handle to the uniform "name"
+     *
+     * The handle stays valid for the whole life of the shader. If the uniform
+     * is not active, or its GLSL type doesn't match T, an invalid handle is
+     * returned.
+     */
+    template <typename T>
+    UniformHandle<T> getUniformHandle(const char *name) const {
+        int index = findUniform(name);
+        if (index < 0)
+            return UniformHandle<T>();
+        if (!UniformTraits<T>::accepts(uniforms[index].type)) {
+            reportTypeMismatch(name);
+            return UniformHandle<T>();
+        }
+        return UniformHandle<T>(uniforms[index].location, index);
+    }
+
+    /** Location of the uniform "name" from the reflected table, -1 if not active */
+    GLint getUniformLocation(const char *name) const;
+    /** Index of the uniform block "name", GL_INVALID_INDEX if not active */
+    GLuint getUniformBlockIndex(const char *name) const;
+    /** Location of the attribute "name", -1 if not active */
+    GLint getAttributeLocation(const char *name) const;
+
+    const std::vector<UniformInfo>& getUniforms() const { return uniforms; }
+    const std::vector<UniformBlockInfo>& getUniformBlocks() const { return uniformBlocks; }
+    const std::vector<AttributeInfo>& getAttributes() const { return attributes; }
+
+    bool status() const { return statusValue; }
+    GLuint getProgram() const { return shaderPointer; }
+
+    /**
+     * @brief Number of Uniform() calls skipped because the program already
+     * had the same value
+     *
+     * Every Uniform() call compares the value with a shadow copy of what was
+     * last uploaded to this program, and calls glUniform* only if it changed.
+     * The program must be the bound one when calling Uniform().
+     */
+    unsigned long getSkippedUploads() const { return skippedUploads; }
+    /** Number of glUniform* calls actually issued */
+    unsigned long getUploads() const { return uploads; }
+    void resetUploadCounters() { skippedUploads = 0; uploads = 0; }
+
+    /**
+     * @brief Forgets the shadow copies, forcing the next Uniform() calls to
+     * upload. Needed if uniforms are changed bypassing this class.
+     */
+    void invalidateShadowState();
+
+    /** true if the program was loaded from the binary cache */
+    bool isFromBinaryCache() const { return fromBinaryCache; }
+    /** seconds spent building (or loading) this program */
+    smRealD getBuildSeconds() const { return buildSeconds; }
+
+    /**
+     * @brief Sets the directory where linked programs are cached.
+     *
+     * An empty string (the default) disables the cache. The directory is
+     * created if it doesn't exist.
+     */
+    static void setBinaryCacheDirectory(const std::string &directory);
+    static BuildStatistics getBuildStatistics();
+    /** Prints the cold and warm build times on stdout */
+    static void reportBuildStatistics();
 
 private:
+    typedef std::unordered_map<std::string, int> NameTable;
+
+    // owns the program object, not copyable
+    Shader(const Shader&);
+    Shader& operator=(const Shader&);
+
     bool statusValue;
+    bool fromBinaryCache;
+    smRealD buildSeconds;
 
     GLuint shaderPointer;
-    bool loadShaderFile(const char *szFile, GLuint shader);
+    static bool loadShaderFile(const char *szFile, std::string &source);
+
+    Shader();
+
+    void build(const std::string &vertexSource, const std::string &fragmentSource, const AttributeBindings &bindings);
+    void beginBuild(const std::string &vertexSource, const std::string &fragmentSource, const AttributeBindings &bindings);
+    bool isBuildComplete() const;
+    void endBuild();
+    GLuint submitShader(GLenum type, const std::string &source);
+    bool checkShader(GLuint shader, const char *stageName);
+    bool checkProgram();
+
+    // state of a build between beginBuild() and endBuild()
+    GLuint pendingVertexShader;
+    GLuint pendingFragmentShader;
+    smHash pendingKey;
+    Timer  buildTimer;
+
+    static bool parallelCompileAvailable();
+    static bool binaryCacheAvailable();
+    static smHash programKey(const std::string &vertexSource, const std::string &fragmentSource, const AttributeBindings &bindings);
+    static std::string binaryCachePath(smHash key);
+    bool loadProgramBinary(smHash key);
+    void saveProgramBinary(smHash key);
+
+    static std::string binaryCacheDirectory;
+    static BuildStatistics buildStatistics;
+    static std::mutex statisticsMutex;
+
+    void reflectProgram();
+    static GLint uniformTypeSize(GLenum type);
+    int findUniform(const char *name) const;
+    bool shadowChanged(int index, const void *data, size_t size);
+    void reportTypeMismatch(const char *name) const;
 
+    // flat reflection tables, filled once after linking
+    std::vector<UniformInfo>      uniforms;
+    std::vector<UniformBlockInfo> uniformBlocks;
+    std::vector<AttributeInfo>    attributes;
 
+    // hashed name -> index in the tables above
+    NameTable uniformNames;
+    NameTable uniformBlockNames;
+    NameTable attributeNames;
 
+    // shadow copies of the uniform values, see UniformInfo::shadowOffset
+    std::vector<unsigned char> shadowValues;
+    unsigned long skippedUploads;
+    unsigned long uploads;
 };
 }
 
@@ -0,0 +1,199 @@
+/*
+ * Example of the OpenGL usage with SDL2
+ * Copyright (C) 2013 Matteo De Carlo <matteo.dek@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "shadercompiler.h"
+#include "GL/glew.h"
+#include <iostream>
+
+using namespace sm;
+
+void ShaderFuture::markFinished(State &state)
+{
+    state.vertexSource.clear();
+    state.fragmentSource.clear();
+    {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        state.finished = true;
+    }
+    state.finishedCondition.notify_all();
+    (*state.pendingCount)--;
+}
+
+bool ShaderFuture::isReady()
+{
+    if (state == nullptr)
+        return false;
+    if (state->finished)
+        return true;
+    if (state->onWorker || !state->shader->isBuildComplete())
+        return false;
+
+    state->shader->endBuild();
+    markFinished(*state);
+    return true;
+}
+
+std::shared_ptr<Shader> ShaderFuture::get()
+{
+    if (state == nullptr)
+        return std::shared_ptr<Shader>();
+
+    if (!state->finished) {
+        if (state->onWorker) {
+            std::unique_lock<std::mutex> lock(state->mutex);
+            while (!state->finished)
+                state->finishedCondition.wait(lock);
+        } else {
+            // blocks in the driver until the program is linked
+            state->shader->endBuild();
+            markFinished(*state);
+        }
+    }
+
+    return state->shader;
+}
+
+/**
+ * Compiler working on the calling thread only, must be used on the thread
+ * owning the OpenGL context.
+ */
+ShaderCompiler::ShaderCompiler()
+    : stopping(false), pendingCount(new std::atomic<int>(0))
+{
+    if (Shader::parallelCompileAvailable()) {
+        // let the driver use as many threads as it wants
+        if (GLEW_KHR_parallel_shader_compile)
+            glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+        else
+            glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+    }
+}
+
+/**
+ * Compiler using "workerCount" threads, each one with its own shared
+ * context made current by "makeCurrent" and released by "release" when the
+ * compiler is destroyed.
+ */
+ShaderCompiler::ShaderCompiler(int workerCount, const ContextCallback &makeCurrent, const ContextCallback &release)
+    : makeCurrent(makeCurrent), release(release), stopping(false), pendingCount(new std::atomic<int>(0))
+{
+    for (int i = 0; i < workerCount; i++)
+        workers.push_back(std::thread(&ShaderCompiler::workerLoop, this));
+}
+
+ShaderCompiler::~ShaderCompiler()
+{
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        stopping = true;
+    }
+    queueCondition.notify_all();
+
+    // workers drain the queue before exiting
+    for (size_t i = 0; i < workers.size(); i++)
+        workers[i].join();
+}
+
+ShaderFuture ShaderCompiler::submit(const std::string &vertexSource, const std::string &fragmentSource,
+                                    const Shader::AttributeBindings &bindings)
+{
+    std::shared_ptr<ShaderFuture::State> state(new ShaderFuture::State);
+    state->shader.reset(new Shader());
+    state->onWorker = !workers.empty();
+    state->pendingCount = pendingCount;
+    state->finished = false;
+    (*pendingCount)++;
+
+    if (state->onWorker) {
+        state->vertexSource = vertexSource;
+        state->fragmentSource = fragmentSource;
+        state->bindings = bindings;
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            queue.push_back(state);
+        }
+        queueCondition.notify_one();
+    } else {
+        state->shader->beginBuild(vertexSource, fragmentSource, bindings);
+    }
+
+    // forget about the programs already collected
+    for (size_t i = 0; i < submitted.size(); ) {
+        if (submitted[i].state->finished) {
+            submitted[i] = submitted.back();
+            submitted.pop_back();
+        } else {
+            i++;
+        }
+    }
+
+    ShaderFuture future(state);
+    submitted.push_back(future);
+    return future;
+}
+
+ShaderFuture ShaderCompiler::submitFiles(const char *vertexShaderFilename, const char *fragmentShaderFilename,
+                                         const Shader::AttributeBindings &bindings)
+{
+    std::string vertexSource, fragmentSource;
+    if (!Shader::loadShaderFile(vertexShaderFilename, vertexSource)) {
+        std::cerr<<"#ERROR: could not load vertex shader "<<vertexShaderFilename<<std::endl;
+        return ShaderFuture();
+    }
+    if (!Shader::loadShaderFile(fragmentShaderFilename, fragmentSource)) {
+        std::cerr<<"#ERROR: could not load fragment shader "<<fragmentShaderFilename<<std::endl;
+        return ShaderFuture();
+    }
+
+    return submit(vertexSource, fragmentSource, bindings);
+}
+
+void ShaderCompiler::waitAll()
+{
+    for (size_t i = 0; i < submitted.size(); i++)
+        submitted[i].get();
+    submitted.clear();
+}
+
+void ShaderCompiler::workerLoop()
+{
+    if (makeCurrent)
+        makeCurrent();
+
+    while (true) {
+        std::shared_ptr<ShaderFuture::State> state;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            while (queue.empty() && !stopping)
+                queueCondition.wait(lock);
+            if (queue.empty())
+                break;
+            state = queue.front();
+            queue.pop_front();
+        }
+
+        state->shader->build(state->vertexSource, state->fragmentSource, state->bindings);
+        // the program must be complete before other contexts use it
+        glFinish();
+        ShaderFuture::markFinished(*state);
+    }
+
+    if (release)
+        release();
+}
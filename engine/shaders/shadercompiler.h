@@ -0,0 +1,139 @@
+/*
+ * Example of the OpenGL usage with SDL2
+ * Copyright (C) 2013 Matteo De Carlo <matteo.dek@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef SM_SHADERCOMPILER_H
+#define SM_SHADERCOMPILER_H
+
+#include "shader.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace sm {
+
+class ShaderCompiler;
+
+/**
+ * @brief Future-like handle to a shader being built by a ShaderCompiler
+ */
+class ShaderFuture
+{
+    friend class ShaderCompiler;
+public:
+    ShaderFuture() {}
+
+    bool valid() const { return state != nullptr; }
+
+    /**
+     * @brief true when get() would return without waiting
+     *
+     * Never blocks. Programs built on the main thread are finalized here as
+     * soon as the driver reports them complete.
+     */
+    bool isReady();
+
+    /**
+     * @brief Waits for the build to finish and returns the shader
+     *
+     * Check Shader::status() on the result, a failed build still returns a
+     * (invalid) shader.
+     */
+    std::shared_ptr<Shader> get();
+
+private:
+    struct State {
+        std::shared_ptr<Shader> shader;
+        std::string vertexSource;
+        std::string fragmentSource;
+        Shader::AttributeBindings bindings;
+        bool onWorker;              // built by a worker thread
+        std::shared_ptr<std::atomic<int> > pendingCount;
+        std::atomic<bool> finished;
+        std::mutex mutex;
+        std::condition_variable finishedCondition;
+    };
+
+    explicit ShaderFuture(const std::shared_ptr<State> &state) : state(state) {}
+
+    static void markFinished(State &state);
+
+    std::shared_ptr<State> state;
+};
+
+/**
+ * @brief Builds many shader programs concurrently
+ *
+ * Submit all the programs up front, then do other work (asset I/O, loading
+ * screen) and collect the results through the returned ShaderFuture.
+ *
+ * Without workers, compilation is submitted to the driver on the calling
+ * thread and, when GL_KHR_parallel_shader_compile is available, polled for
+ * completion without blocking. With workers, each worker thread first calls
+ * the makeCurrent callback, which must bind an OpenGL context shared with
+ * the main one (e.g. created with SDL_GL_SHARE_WITH_CURRENT_CONTEXT), and
+ * then builds programs synchronously on it.
+ */
+class ShaderCompiler
+{
+public:
+    typedef std::function<void()> ContextCallback;
+
+    ShaderCompiler();
+    ShaderCompiler(int workerCount, const ContextCallback &makeCurrent, const ContextCallback &release);
+    ~ShaderCompiler();
+
+    ShaderFuture submit(const std::string &vertexSource, const std::string &fragmentSource,
+                        const Shader::AttributeBindings &bindings);
+    ShaderFuture submitFiles(const char *vertexShaderFilename, const char *fragmentShaderFilename,
+                             const Shader::AttributeBindings &bindings);
+
+    /** Number of submitted programs not finished yet */
+    int getPendingCount() const { return *pendingCount; }
+
+    /** Blocks until every submitted program is built */
+    void waitAll();
+
+private:
+    ShaderCompiler(const ShaderCompiler&);
+    ShaderCompiler& operator=(const ShaderCompiler&);
+
+    void workerLoop();
+
+    std::vector<std::thread> workers;
+    ContextCallback makeCurrent;
+    ContextCallback release;
+
+    std::mutex queueMutex;
+    std::condition_variable queueCondition;
+    std::deque<std::shared_ptr<ShaderFuture::State> > queue;
+    std::vector<ShaderFuture> submitted;
+    bool stopping;
+
+    std::shared_ptr<std::atomic<int> > pendingCount;
+};
+
+}
+
+#endif // SM_SHADERCOMPILER_H
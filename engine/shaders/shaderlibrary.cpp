@@ -0,0 +1,90 @@
+/*
+ * Example of the OpenGL usage with SDL2
+ * Copyright (C) 2013 Matteo De Carlo <matteo.dek@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "shaderlibrary.h"
+#include <sstream>
+
+using namespace sm;
+
+ShaderLibrary::ShaderLibrary(ShaderCompiler &compiler)
+    : compiler(compiler), cacheHits(0), cacheMisses(0)
+{
+}
+
+void ShaderLibrary::clear()
+{
+    variants.clear();
+    programs.clear();
+}
+
+const ShaderLibrary::ProgramSource* ShaderLibrary::getProgramSource(const std::string &vertexFile,
+                                                                    const std::string &fragmentFile,
+                                                                    const Shader::AttributeBindings &bindings)
+{
+    // the indices are part of the key, like they are part of the hash
+    std::stringstream key;
+    key<<vertexFile<<'\n'<<fragmentFile;
+    for (Shader::AttributeBindings::const_iterator it = bindings.begin(); it != bindings.end(); ++it)
+        key<<'\n'<<it->index<<' '<<it->name;
+    const std::string name = key.str();
+
+    std::unordered_map<std::string, ProgramSource>::const_iterator found = programs.find(name);
+    if (found != programs.end())
+        return &found->second;
+
+    ProgramSource program;
+    if (!ShaderSource::expandIncludes(vertexFile, program.vertex)
+        || !ShaderSource::expandIncludes(fragmentFile, program.fragment))
+        return nullptr;
+
+    program.hash = hashString(program.vertex);
+    program.hash = hashString(program.fragment, program.hash);
+    for (Shader::AttributeBindings::const_iterator it = bindings.begin(); it != bindings.end(); ++it) {
+        program.hash = hashBytes(&it->index, sizeof(it->index), program.hash);
+        program.hash = hashString(it->name, program.hash);
+    }
+
+    return &(programs[name] = program);
+}
+
+ShaderFuture ShaderLibrary::getVariant(const std::string &vertexFile, const std::string &fragmentFile,
+                                       const ShaderSource::Defines &defines,
+                                       const Shader::AttributeBindings &bindings)
+{
+    const ProgramSource *program = getProgramSource(vertexFile, fragmentFile, bindings);
+    if (program == nullptr)
+        return ShaderFuture();
+
+    VariantKey key;
+    key.sourceHash = program->hash;
+    key.definesHash = ShaderSource::hashDefines(defines);
+
+    std::unordered_map<VariantKey, ShaderFuture, VariantKeyHasher>::const_iterator found = variants.find(key);
+    if (found != variants.end()) {
+        cacheHits++;
+        return found->second;
+    }
+
+    cacheMisses++;
+    ShaderFuture future = compiler.submit(ShaderSource::injectDefines(program->vertex, defines),
+                                          ShaderSource::injectDefines(program->fragment, defines),
+                                          bindings);
+    variants[key] = future;
+    return future;
+}
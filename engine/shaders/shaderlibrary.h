@@ -0,0 +1,96 @@
+/*
+ * Example of the OpenGL usage with SDL2
+ * Copyright (C) 2013 Matteo De Carlo <matteo.dek@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef SM_SHADERLIBRARY_H
+#define SM_SHADERLIBRARY_H
+
+#include "shadercompiler.h"
+#include "shadersource.h"
+#include <string>
+#include <unordered_map>
+
+namespace sm {
+
+/**
+ * @brief Permutation cache of shader programs
+ *
+ * Every (vertex file, fragment file, bindings) triple is read and expanded
+ * once. Each variant, identified by the hash of the expanded sources and
+ * the hash of the define set, is submitted to the ShaderCompiler only the
+ * first time it's requested; all the materials asking for the same variant
+ * share the same program.
+ */
+class ShaderLibrary
+{
+public:
+    explicit ShaderLibrary(ShaderCompiler &compiler);
+
+    /**
+     * @brief Gets the variant of a program compiled with "defines"
+     *
+     * @return sm::ShaderFuture invalid if a source file couldn't be read
+     */
+    ShaderFuture getVariant(const std::string &vertexFile, const std::string &fragmentFile,
+                            const ShaderSource::Defines &defines,
+                            const Shader::AttributeBindings &bindings = Shader::AttributeBindings());
+
+    /** Forgets the expanded sources, so that files get read again */
+    void reloadSources() { programs.clear(); }
+    /** Drops all the variants (the shaders live as long as someone uses them) */
+    void clear();
+
+    size_t getVariantCount() const { return variants.size(); }
+    int getCacheHits() const { return cacheHits; }
+    int getCacheMisses() const { return cacheMisses; }
+
+private:
+    struct ProgramSource {
+        std::string vertex;
+        std::string fragment;
+        smHash      hash;
+    };
+
+    struct VariantKey {
+        smHash sourceHash;
+        smHash definesHash;
+
+        bool operator==(const VariantKey &other) const {
+            return sourceHash == other.sourceHash && definesHash == other.definesHash;
+        }
+    };
+
+    struct VariantKeyHasher {
+        size_t operator()(const VariantKey &key) const {
+            return size_t(key.sourceHash ^ (key.definesHash * 31));
+        }
+    };
+
+    const ProgramSource* getProgramSource(const std::string &vertexFile, const std::string &fragmentFile,
+                                          const Shader::AttributeBindings &bindings);
+
+    ShaderCompiler &compiler;
+    std::unordered_map<std::string, ProgramSource> programs;
+    std::unordered_map<VariantKey, ShaderFuture, VariantKeyHasher> variants;
+    int cacheHits;
+    int cacheMisses;
+};
+
+}
+
+#endif // SM_SHADERLIBRARY_H
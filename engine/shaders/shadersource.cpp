@@ -0,0 +1,238 @@
+/*
+ * Example of the OpenGL usage with SDL2
+ * Copyright (C) 2013 Matteo De Carlo <matteo.dek@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "shadersource.h"
+#include "../errorhandling.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace sm;
+
+namespace {
+    const int MAX_INCLUDE_DEPTH = 32;
+
+    std::string directoryOf(const std::string &path)
+    {
+        std::string::size_type slash = path.find_last_of("/\\");
+        if (slash == std::string::npos)
+            return std::string();
+        return path.substr(0, slash + 1);
+    }
+
+    /** true if "line" starts with "directive" after optional blanks */
+    bool isDirective(const std::string &line, const char *directive, std::string::size_type &after)
+    {
+        std::string::size_type start = line.find_first_not_of(" \t");
+        if (start == std::string::npos)
+            return false;
+        std::string::size_type length = strlen(directive);
+        if (line.compare(start, length, directive) != 0)
+            return false;
+        after = start + length;
+        return true;
+    }
+}
+
+bool ShaderSource::readFile(const std::string &path, std::string &contents)
+{
+#ifndef WIN32
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        return false;
+    }
+
+    if (info.st_size == 0) {
+        contents.clear();
+        close(fd);
+        return true;
+    }
+
+    void *mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+        return false;
+
+    contents.assign(static_cast<const char*>(mapping), info.st_size);
+    munmap(mapping, info.st_size);
+    return true;
+#else
+    std::ifstream stream(path.c_str(), std::ios_base::in | std::ios_base::binary);
+    if (!stream)
+        return false;
+
+    stream.seekg(0, std::ios_base::end);
+    std::streamoff size = stream.tellg();
+    stream.seekg(0, std::ios_base::beg);
+
+    contents.resize(size_t(size));
+    if (size > 0 && !stream.read(&contents[0], size))
+        return false;
+    return true;
+#endif
+}
+
+bool ShaderSource::expandIncludes(const std::string &path, std::string &source, std::vector<std::string> *files)
+{
+    std::vector<std::string> localFiles;
+    std::vector<std::string> &readFiles = files != nullptr ? *files : localFiles;
+    readFiles.clear();
+    source.clear();
+    return expand(path, source, readFiles, 0);
+}
+
+bool ShaderSource::expand(const std::string &path, std::string &source, std::vector<std::string> &files, int depth)
+{
+    if (depth > MAX_INCLUDE_DEPTH) {
+        emitError("shader includes nested too deep in " + path);
+        return false;
+    }
+
+    std::string contents;
+    if (!readFile(path, contents)) {
+        emitError("could not read shader source " + path);
+        return false;
+    }
+
+    const int fileIndex = int(files.size());
+    files.push_back(path);
+    const std::string directory = directoryOf(path);
+
+    source.reserve(source.size() + contents.size());
+
+    std::string::size_type begin = 0;
+    int lineNumber = 0;
+    while (begin < contents.size()) {
+        std::string::size_type end = contents.find('\n', begin);
+        if (end == std::string::npos)
+            end = contents.size();
+        std::string line = contents.substr(begin, end - begin);
+        begin = end + 1;
+        lineNumber++;
+
+        std::string::size_type after;
+        if (!isDirective(line, "#include", after)) {
+            source.append(line);
+            source.push_back('\n');
+            continue;
+        }
+
+        std::string::size_type openQuote = line.find('"', after);
+        std::string::size_type closeQuote = openQuote == std::string::npos ? openQuote : line.find('"', openQuote + 1);
+        if (closeQuote == std::string::npos) {
+            std::stringstream message;
+            message<<path<<':'<<lineNumber<<" malformed #include";
+            emitError(message.str());
+            return false;
+        }
+
+        std::string included = directory + line.substr(openQuote + 1, closeQuote - openQuote - 1);
+        if (std::find(files.begin(), files.end(), included) != files.end()) {
+            // already included once
+            source.push_back('\n');
+            continue;
+        }
+
+        std::stringstream lineDirective;
+        lineDirective<<"#line 1 "<<files.size()<<'\n';
+        source.append(lineDirective.str());
+
+        if (!expand(included, source, files, depth + 1))
+            return false;
+
+        lineDirective.str(std::string());
+        lineDirective<<"\n#line "<<lineNumber + 1<<' '<<fileIndex<<'\n';
+        source.append(lineDirective.str());
+    }
+
+    return true;
+}
+
+std::string ShaderSource::injectDefines(const std::string &source, const Defines &defines)
+{
+    if (defines.empty())
+        return source;
+
+    std::stringstream block;
+    for (Defines::const_iterator it = defines.begin(); it != defines.end(); ++it)
+        block<<"#define "<<it->first<<' '<<it->second<<'\n';
+
+    // #version must stay the first directive
+    std::string::size_type insertAt = 0;
+    int nextLine = 1;
+    std::string::size_type begin = 0;
+    int lineNumber = 0;
+    while (begin < source.size()) {
+        std::string::size_type end = source.find('\n', begin);
+        if (end == std::string::npos)
+            end = source.size();
+        lineNumber++;
+
+        std::string::size_type after;
+        if (isDirective(source.substr(begin, end - begin), "#version", after)) {
+            insertAt = std::min(end + 1, source.size());
+            nextLine = lineNumber + 1;
+            break;
+        }
+        begin = end + 1;
+    }
+
+    block<<"#line "<<nextLine<<" 0\n";
+
+    std::string result;
+    result.reserve(source.size() + block.str().size() + 1);
+    result.append(source, 0, insertAt);
+    if (insertAt > 0 && result[insertAt - 1] != '\n')
+        result.push_back('\n');
+    result.append(block.str());
+    result.append(source, insertAt, std::string::npos);
+    return result;
+}
+
+bool ShaderSource::load(const std::string &path, const Defines &defines, std::string &source)
+{
+    std::string expanded;
+    if (!expandIncludes(path, expanded))
+        return false;
+
+    source = injectDefines(expanded, defines);
+    return true;
+}
+
+smHash ShaderSource::hashDefines(const Defines &defines)
+{
+    smHash hash = HASH_SEED;
+    for (Defines::const_iterator it = defines.begin(); it != defines.end(); ++it) {
+        hash = hashString(it->first, hash);
+        hash = hashString(it->second, hash);
+    }
+    return hash;
+}
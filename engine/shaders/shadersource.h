@@ -0,0 +1,77 @@
+/*
+ * Example of the OpenGL usage with SDL2
+ * Copyright (C) 2013 Matteo De Carlo <matteo.dek@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef SM_SHADERSOURCE_H
+#define SM_SHADERSOURCE_H
+
+#include "../hash.h"
+#include <map>
+#include <string>
+#include <vector>
+
+namespace sm {
+
+/**
+ * @brief Loading and preprocessing of GLSL source files
+ *
+ * Files are read whole (memory mapped where available), with no limit on
+ * their size. `#include "file"` lines are expanded recursively, relative to
+ * the including file, each file at most once. Defines are injected right
+ * after the `#version` line, and `#line` directives keep the driver logs
+ * pointing at the original lines.
+ */
+class ShaderSource
+{
+public:
+    /** Preprocessor defines, NAME -> value. Sorted, so equal sets hash equal */
+    typedef std::map<std::string, std::string> Defines;
+
+    /**
+     * @brief Reads the whole file "path" into "contents"
+     *
+     * @return bool false if the file couldn't be read
+     */
+    static bool readFile(const std::string &path, std::string &contents);
+
+    /**
+     * @brief Reads "path" expanding all its includes
+     *
+     * @param files if not null, receives the list of files read, the first
+     * one being "path". Its index is the source string number used in the
+     * `#line` directives.
+     * @return bool false if any file couldn't be read
+     */
+    static bool expandIncludes(const std::string &path, std::string &source,
+                               std::vector<std::string> *files = nullptr);
+
+    /** Returns "source" with "defines" inserted after the #version line */
+    static std::string injectDefines(const std::string &source, const Defines &defines);
+
+    /** Reads, expands includes and injects defines in a single step */
+    static bool load(const std::string &path, const Defines &defines, std::string &source);
+
+    static smHash hashDefines(const Defines &defines);
+
+private:
+    static bool expand(const std::string &path, std::string &source, std::vector<std::string> &files, int depth);
+};
+
+}
+
+#endif // SM_SHADERSOURCE_H
@@ -0,0 +1,104 @@
+/*
+ * Example of the OpenGL usage with SDL2
+ * Copyright (C) 2013 Matteo De Carlo <matteo.dek@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef SM_UNIFORMHANDLE_H
+#define SM_UNIFORMHANDLE_H
+
+#include "../math/math.h"
+#include "GL/glew.h"
+
+namespace sm {
+
+/**
+ * @brief Tells which GLSL uniform types can be set with a C++ type T
+ */
+template <typename T>
+struct UniformTraits;
+
+template <>
+struct UniformTraits<int> {
+    static bool accepts(GLenum type) {
+        switch (type) {
+        case GL_INT:
+        case GL_BOOL:
+        case GL_SAMPLER_1D:
+        case GL_SAMPLER_2D:
+        case GL_SAMPLER_3D:
+        case GL_SAMPLER_CUBE:
+        case GL_SAMPLER_2D_SHADOW:
+        case GL_SAMPLER_2D_ARRAY:
+            return true;
+        default:
+            return false;
+        }
+    }
+};
+
+template <>
+struct UniformTraits<smReal> {
+    static bool accepts(GLenum type) { return type == GL_FLOAT; }
+};
+
+template <>
+struct UniformTraits<Vector3> {
+    static bool accepts(GLenum type) { return type == GL_FLOAT_VEC3; }
+};
+
+template <>
+struct UniformTraits<Vector4> {
+    static bool accepts(GLenum type) { return type == GL_FLOAT_VEC4; }
+};
+
+template <>
+struct UniformTraits<Matrix33> {
+    static bool accepts(GLenum type) { return type == GL_FLOAT_MAT3; }
+};
+
+template <>
+struct UniformTraits<Matrix44> {
+    static bool accepts(GLenum type) { return type == GL_FLOAT_MAT4; }
+};
+
+/**
+ * @brief Stable, typed reference to an active uniform of a Shader
+ *
+ * Handles are obtained once from Shader::getUniformHandle() and then used to
+ * set the uniform without any string lookup. A default constructed handle is
+ * invalid, setting it is a no-op (like setting location -1 in OpenGL).
+ */
+template <typename T>
+class UniformHandle
+{
+    friend class Shader;
+public:
+    UniformHandle() : location(-1), index(-1) {}
+
+    bool isValid() const { return location != -1; }
+    GLint getLocation() const { return location; }
+
+private:
+    UniformHandle(GLint location, int index) : location(location), index(index) {}
+
+    GLint location;
+    int   index;    // position in the reflected uniform table of the Shader
+};
+
+}
+
+#endif // SM_UNIFORMHANDLE_H
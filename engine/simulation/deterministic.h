@@ -0,0 +1,122 @@
+/*
+ * Example of the OpenGL usage with SDL2
+ * Copyright (C) 2013 Matteo De Carlo <matteo.dek@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef SM_DETERMINISTIC_H
+#define SM_DETERMINISTIC_H
+
+#include "../jobs/jobsystem.h"
+#include <cstdint>
+#include <vector>
+
+namespace sm {
+
+/**
+ * @brief Seeded random numbers, the same on every platform (PCG32)
+ *
+ * Unlike rand() or the <random> distributions, the sequence only depends
+ * on the seed. Systems should split() their own generator rather than
+ * share one, so their draws don't depend on the order systems run in.
+ */
+class Random
+{
+public:
+    explicit Random(uint64_t seed = 0x853c49e6748fea9bULL, uint64_t stream = 0xda3e39cb94b95bdbULL)
+        : state(0), increment((stream << 1) | 1)
+    {
+        next();
+        state += seed;
+        next();
+    }
+
+    uint32_t next() {
+        const uint64_t old = state;
+        state = old * 6364136223846793005ULL + increment;
+        const uint32_t shifted = uint32_t(((old >> 18) ^ old) >> 27);
+        const uint32_t rotation = uint32_t(old >> 59);
+        return (shifted >> rotation) | (shifted << ((32 - rotation) & 31));
+    }
+
+    /** Uniform in [0, 1), 24 bits */
+    float nextFloat() { return float(next() >> 8) * (1.0f / 16777216.0f); }
+
+    /**
+     * Uniform in [0, bound), without modulo bias. The range is empty for
+     * bound == 0: 0 is returned then, without advancing the generator
+     */
+    uint32_t nextBelow(uint32_t bound) {
+        if (bound == 0)
+            return 0;
+        const uint32_t threshold = (0u - bound) % bound;
+        while (true) {
+            const uint32_t value = next();
+            if (value >= threshold)
+                return value % bound;
+        }
+    }
+
+    /** An independent generator for "id" (a system, an entity...) */
+    Random split(uint64_t id) const {
+        Random copy(*this);
+        const uint64_t seed = (uint64_t(copy.next()) << 32) | copy.next();
+        return Random(seed ^ (id * 0x9e3779b97f4a7c15ULL), id);
+    }
+
+private:
+    uint64_t state;
+    uint64_t increment;
+};
+
+/**
+ * @brief Sum of value(i) for i in [0, count), bit identical whatever the
+ * number of threads
+ *
+ * Floating point addition isn't associative, so a parallel sum depends on
+ * how the range is split. Here partial sums are always taken over the same
+ * fixed blocks and added in block order.
+ */
+template<class F>
+double deterministicSum(int count, F value, JobSystem *jobs = nullptr)
+{
+    const int BLOCK = 1024;
+    const int blocks = (count + BLOCK - 1) / BLOCK;
+    std::vector<double> partial(blocks, 0.0);
+
+    const auto sumBlocks = [&](int begin, int end) {
+        for (int b = begin; b < end; b++) {
+            double sum = 0.0;
+            const int last = (b + 1) * BLOCK < count ? (b + 1) * BLOCK : count;
+            for (int i = b * BLOCK; i < last; i++)
+                sum += value(i);
+            partial[b] = sum;
+        }
+    };
+    if (jobs != nullptr)
+        jobs->parallelFor(0, blocks, sumBlocks, 1);
+    else
+        sumBlocks(0, blocks);
+
+    double total = 0.0;
+    for (int b = 0; b < blocks; b++)
+        total += partial[b];
+    return total;
+}
+
+}
+
+#endif // SM_DETERMINISTIC_H
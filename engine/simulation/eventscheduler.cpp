@@ -0,0 +1,194 @@
+/*
+ * Example of the OpenGL usage with SDL2
+ * Copyright (C) 2013 Matteo De Carlo <matteo.dek@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "eventscheduler.h"
+#include "../jobs/jobsystem.h"
+#include <algorithm>
+
+using namespace sm;
+
+namespace {
+    uint64_t makeId(int index, uint32_t generation)
+    {
+        return (uint64_t(generation) << 32) | uint32_t(index);
+    }
+}
+
+EventScheduler::EventScheduler(uint64_t tick)
+    : pendingCount(0), currentTick(tick)
+{
+    for (int i = 0; i <= OVERFLOW_LIST; i++)
+        heads[i] = NO_EVENT;
+}
+
+void EventScheduler::setHandler(int type, const Handler &handler)
+{
+    if (type >= int(handlers.size()))
+        handlers.resize(type + 1);
+    handlers[type] = handler;
+}
+
+void EventScheduler::insert(int event)
+{
+    Event &e = events[event];
+
+    int list = OVERFLOW_LIST;
+    for (int level = 0; level < LEVELS; level++) {
+        const int shift = (level + 1) * SLOT_BITS;
+        if ((e.tick >> shift) == (currentTick >> shift)) {
+            list = level * SLOTS + int((e.tick >> (level * SLOT_BITS)) & (SLOTS - 1));
+            break;
+        }
+    }
+
+    e.list = list;
+    e.prev = NO_EVENT;
+    e.next = heads[list];
+    if (e.next != NO_EVENT)
+        events[e.next].prev = event;
+    heads[list] = event;
+}
+
+void EventScheduler::unlink(int event)
+{
+    Event &e = events[event];
+    if (e.prev != NO_EVENT)
+        events[e.prev].next = e.next;
+    else
+        heads[e.list] = e.next;
+    if (e.next != NO_EVENT)
+        events[e.next].prev = e.prev;
+}
+
+void EventScheduler::release(int event)
+{
+    Event &e = events[event];
+    e.list = NO_EVENT;
+    e.generation++;
+    freeEvents.push_back(event);
+    pendingCount--;
+}
+
+uint64_t EventScheduler::schedule(uint64_t tick, int type, uint64_t payload)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    int event;
+    if (!freeEvents.empty()) {
+        event = freeEvents.back();
+        freeEvents.pop_back();
+    } else {
+        event = int(events.size());
+        events.push_back(Event());
+        events[event].generation = 0;
+    }
+
+    Event &e = events[event];
+    e.tick = tick > currentTick ? tick : currentTick + 1;
+    e.payload = payload;
+    e.type = type;
+    insert(event);
+    pendingCount++;
+    return makeId(event, e.generation);
+}
+
+bool EventScheduler::cancel(uint64_t id)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    const int event = int(uint32_t(id));
+    if (event >= int(events.size()))
+        return false;
+    Event &e = events[event];
+    if (e.list == NO_EVENT || e.generation != uint32_t(id >> 32))
+        return false;
+
+    unlink(event);
+    release(event);
+    return true;
+}
+
+void EventScheduler::cascade(int list)
+{
+    int event = heads[list];
+    heads[list] = NO_EVENT;
+    while (event != NO_EVENT) {
+        const int next = events[event].next;
+        insert(event);
+        event = next;
+    }
+}
+
+void EventScheduler::advance(JobSystem *jobs)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        currentTick++;
+
+        // a turn of the wheels above begins: move their slot down, top first
+        int top = 0;
+        while (top < LEVELS && (currentTick & ((uint64_t(1) << ((top + 1) * SLOT_BITS)) - 1)) == 0)
+            top++;
+        if (top == LEVELS)
+            cascade(OVERFLOW_LIST);
+        for (int level = std::min(top, LEVELS - 1); level >= 1; level--)
+            cascade(level * SLOTS + int((currentTick >> (level * SLOT_BITS)) & (SLOTS - 1)));
+
+        due.clear();
+        const int list = int(currentTick & (SLOTS - 1));
+        int event = heads[list];
+        while (event != NO_EVENT) {
+            const Event &e = events[event];
+            const int next = e.next;
+            ScheduledEvent scheduled = { makeId(event, e.generation), e.tick, e.type, e.payload };
+            due.push_back(scheduled);
+            release(event);
+            event = next;
+        }
+        heads[list] = NO_EVENT;
+    }
+
+    // group by type
+    const int typeCount = int(handlers.size());
+    typeStart.assign(typeCount + 2, 0);
+    for (size_t i = 0; i < due.size(); i++) {
+        const int type = due[i].type >= 0 && due[i].type < typeCount ? due[i].type : typeCount;
+        typeStart[type + 1]++;
+    }
+    for (int type = 0; type <= typeCount; type++)
+        typeStart[type + 1] += typeStart[type];
+    batch.resize(due.size());
+    typeCursor.assign(typeStart.begin(), typeStart.end() - 1);
+    for (size_t i = 0; i < due.size(); i++) {
+        const int type = due[i].type >= 0 && due[i].type < typeCount ? due[i].type : typeCount;
+        batch[typeCursor[type]++] = due[i];
+    }
+
+    const auto dispatch = [this](int begin, int end) {
+        for (int type = begin; type < end; type++) {
+            const int count = typeStart[type + 1] - typeStart[type];
+            if (count > 0 && handlers[type])
+                handlers[type](&batch[typeStart[type]], count);
+        }
+    };
+    if (jobs != nullptr)
+        jobs->parallelFor(0, typeCount, dispatch, 1);
+    else
+        dispatch(0, typeCount);
+}
@@ -0,0 +1,127 @@
+/*
+ * Example of the OpenGL usage with SDL2
+ * Copyright (C) 2013 Matteo De Carlo <matteo.dek@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef SM_EVENTSCHEDULER_H
+#define SM_EVENTSCHEDULER_H
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace sm {
+
+class JobSystem;
+
+/** @brief An event as handed to its handler */
+struct ScheduledEvent
+{
+    uint64_t id;
+    uint64_t tick;
+    int      type;
+    uint64_t payload;     // e.g. the entity or building the event is about
+};
+
+/**
+ * @brief Events due at a future simulation tick (construction completed,
+ * shift change, bus departure...), so that nothing polls every tick
+ *
+ * The events sit in a hierarchical timing wheel: LEVELS wheels of
+ * SLOTS slots, each slot of a wheel spanning a whole turn of the wheel
+ * below. An event goes into the lowest wheel whose turn contains its tick,
+ * and moves down a wheel each time that turn begins, so scheduling and
+ * cancelling are O(1) and advancing a tick only touches the events due.
+ * Events farther than a turn of the top wheel wait in an overflow list.
+ *
+ * advance() hands the events due in the new tick to the handler of their
+ * type, in batches, the types in parallel if a JobSystem is given.
+ * Handlers may schedule and cancel events, also from worker threads.
+ */
+class EventScheduler
+{
+public:
+    /** Receives all the events of one type due in a tick */
+    typedef std::function<void(const ScheduledEvent *events, int count)> Handler;
+
+    static const int SLOT_BITS = 8;
+    static const int SLOTS = 1 << SLOT_BITS;
+    static const int LEVELS = 4;
+
+    explicit EventScheduler(uint64_t tick = 0);
+
+    /** Events of types without a handler are dropped */
+    void setHandler(int type, const Handler &handler);
+
+    /**
+     * @brief Schedules an event at "tick", the next tick if already past
+     *
+     * @return uint64_t id to cancel the event with
+     */
+    uint64_t schedule(uint64_t tick, int type, uint64_t payload = 0);
+    uint64_t scheduleAfter(uint64_t ticks, int type, uint64_t payload = 0) {
+        return schedule(currentTick + ticks, type, payload);
+    }
+    /** @return bool false if the event was already dispatched or cancelled */
+    bool cancel(uint64_t id);
+
+    /** Moves to the next tick and dispatches the events due in it */
+    void advance(JobSystem *jobs = nullptr);
+
+    uint64_t getTick() const { return currentTick; }
+    int getPendingCount() const { return pendingCount; }
+    /** Events dispatched by the last advance() */
+    int getDispatchedCount() const { return int(batch.size()); }
+
+private:
+    static const int OVERFLOW_LIST = LEVELS * SLOTS;
+    static const int NO_EVENT = -1;
+
+    struct Event {
+        uint64_t tick;
+        uint64_t payload;
+        int type;
+        int prev, next;
+        int list;             // slot the event is in, NO_EVENT if free
+        uint32_t generation;  // bumped when freed, stale ids don't match
+    };
+
+    void insert(int event);
+    void unlink(int event);
+    void release(int event);
+    /** Moves the events of "list" to the wheels they belong to now */
+    void cascade(int list);
+
+    std::vector<Event> events;
+    std::vector<int> freeEvents;
+    int heads[LEVELS * SLOTS + 1];
+    int pendingCount;
+    uint64_t currentTick;
+
+    std::vector<Handler> handlers;
+    std::vector<ScheduledEvent> due;
+    std::vector<ScheduledEvent> batch;     // due events grouped by type
+    std::vector<int> typeStart;
+    std::vector<int> typeCursor;
+
+    std::mutex mutex;
+};
+
+}
+
+#endif // SM_EVENTSCHEDULER_H
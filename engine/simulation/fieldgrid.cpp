@@ -0,0 +1,179 @@
+/*
+ * Example of the OpenGL usage with SDL2
+ * Copyright (C) 2013 Matteo De Carlo <matteo.dek@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "fieldgrid.h"
+#include "../jobs/jobsystem.h"
+#include "../timer.h"
+#include <algorithm>
+#include <cmath>
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define SM_FIELDGRID_SSE
+#include <xmmintrin.h>
+#endif
+
+using namespace sm;
+
+namespace {
+    // a tile is skipped after this many steps without changes
+    const int STABLE_STEPS = 2;
+}
+
+FieldGrid::FieldGrid(int width, int height, float boundary, int tileSize)
+    : width(width), height(height), tileSize(tileSize), current(0), threshold(1e-5f),
+      updatedCells(0), skippedTiles(0), totalCells(0), totalSeconds(0)
+{
+    // border of one cell, rows padded to a multiple of 4 floats
+    pitch = (width + 2 + 3) & ~3;
+    tilesX = (width + tileSize - 1) / tileSize;
+    tilesY = (height + tileSize - 1) / tileSize;
+
+    for (int b = 0; b < 2; b++) {
+        buffers[b].assign(size_t(pitch) * (height + 2), boundary);
+        for (int y = 0; y < height; y++)
+            std::fill(&buffers[b][index(0, y)], &buffers[b][index(0, y)] + width, 0.0f);
+    }
+
+    stableSteps.assign(tilesX * tilesY, 0);
+    tileChange.assign(tilesX * tilesY, 0.0f);
+}
+
+void FieldGrid::set(int x, int y, float value)
+{
+    buffers[current][index(x, y)] = value;
+    wake(tileOf(x, y));
+}
+
+void FieldGrid::setSource(int x, int y, float value)
+{
+    if (sources.empty())
+        sources.assign(buffers[0].size(), 0.0f);
+    sources[index(x, y)] = value;
+    wake(tileOf(x, y));
+}
+
+void FieldGrid::wakeAll()
+{
+    std::fill(stableSteps.begin(), stableSteps.end(), 0);
+}
+
+bool FieldGrid::canSkip(int tile) const
+{
+    const int tx = tile % tilesX, ty = tile / tilesX;
+    for (int y = std::max(0, ty - 1); y <= std::min(tilesY - 1, ty + 1); y++) {
+        for (int x = std::max(0, tx - 1); x <= std::min(tilesX - 1, tx + 1); x++) {
+            if (stableSteps[y * tilesX + x] < STABLE_STEPS)
+                return false;
+        }
+    }
+    return true;
+}
+
+float FieldGrid::computeTile(int tile) const
+{
+    const float *source = buffers[current].data();
+    float *destination = const_cast<float*>(buffers[1 - current].data());
+    const float *emission = sources.empty() ? nullptr : sources.data();
+    const bool ninePoint = weights.corner != 0.0f;
+
+    const int x0 = (tile % tilesX) * tileSize, x1 = std::min(width, x0 + tileSize);
+    const int y0 = (tile / tilesX) * tileSize, y1 = std::min(height, y0 + tileSize);
+
+    float maxChange = 0.0f;
+#ifdef SM_FIELDGRID_SSE
+    const __m128 center = _mm_set1_ps(weights.center);
+    const __m128 edge = _mm_set1_ps(weights.edge);
+    const __m128 corner = _mm_set1_ps(weights.corner);
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    __m128 change = _mm_setzero_ps();
+#endif
+
+    for (int y = y0; y < y1; y++) {
+        const int row = index(0, y);
+        int x = x0;
+#ifdef SM_FIELDGRID_SSE
+        for (; x + 4 <= x1; x += 4) {
+            const float *c = source + row + x;
+            const __m128 middle = _mm_loadu_ps(c);
+            __m128 sides = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(c - 1), _mm_loadu_ps(c + 1)),
+                                      _mm_add_ps(_mm_loadu_ps(c - pitch), _mm_loadu_ps(c + pitch)));
+            __m128 value = _mm_add_ps(_mm_mul_ps(middle, center), _mm_mul_ps(sides, edge));
+            if (ninePoint) {
+                __m128 corners = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(c - pitch - 1), _mm_loadu_ps(c - pitch + 1)),
+                                            _mm_add_ps(_mm_loadu_ps(c + pitch - 1), _mm_loadu_ps(c + pitch + 1)));
+                value = _mm_add_ps(value, _mm_mul_ps(corners, corner));
+            }
+            if (emission != nullptr)
+                value = _mm_add_ps(value, _mm_loadu_ps(emission + row + x));
+            _mm_storeu_ps(destination + row + x, value);
+            change = _mm_max_ps(change, _mm_and_ps(_mm_sub_ps(value, middle), absMask));
+        }
+#endif
+        for (; x < x1; x++) {
+            const float *c = source + row + x;
+            float value = c[0] * weights.center + (c[-1] + c[1] + c[-pitch] + c[pitch]) * weights.edge;
+            if (ninePoint)
+                value += (c[-pitch-1] + c[-pitch+1] + c[pitch-1] + c[pitch+1]) * weights.corner;
+            if (emission != nullptr)
+                value += emission[row + x];
+            destination[row + x] = value;
+            maxChange = std::max(maxChange, std::fabs(value - c[0]));
+        }
+    }
+
+#ifdef SM_FIELDGRID_SSE
+    float lanes[4];
+    _mm_storeu_ps(lanes, change);
+    maxChange = std::max(std::max(maxChange, std::max(lanes[0], lanes[1])), std::max(lanes[2], lanes[3]));
+#endif
+    return maxChange;
+}
+
+void FieldGrid::step(JobSystem *jobs)
+{
+    Timer timer;
+
+    activeTiles.clear();
+    for (int tile = 0; tile < tilesX * tilesY; tile++) {
+        if (!canSkip(tile))
+            activeTiles.push_back(tile);
+    }
+    skippedTiles = tilesX * tilesY - int(activeTiles.size());
+
+    const auto computeTiles = [this](int begin, int end) {
+        for (int a = begin; a < end; a++)
+            tileChange[activeTiles[a]] = computeTile(activeTiles[a]);
+    };
+    if (jobs != nullptr)
+        jobs->parallelFor(0, int(activeTiles.size()), computeTiles, 1);
+    else
+        computeTiles(0, int(activeTiles.size()));
+
+    updatedCells = 0;
+    for (size_t a = 0; a < activeTiles.size(); a++) {
+        const int tile = activeTiles[a];
+        stableSteps[tile] = tileChange[tile] < threshold ? stableSteps[tile] + 1 : 0;
+        const int tx = tile % tilesX, ty = tile / tilesX;
+        updatedCells += long(std::min(tileSize, width - tx * tileSize)) * std::min(tileSize, height - ty * tileSize);
+    }
+
+    current = 1 - current;
+
+    totalCells += updatedCells;
+    totalSeconds += timer.getElapsedSeconds();
+}
@@ -0,0 +1,133 @@
+/*
+ * Example of the OpenGL usage with SDL2
+ * Copyright (C) 2013 Matteo De Carlo <matteo.dek@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef SM_FIELDGRID_H
+#define SM_FIELDGRID_H
+
+#include <vector>
+
+namespace sm {
+
+class JobSystem;
+
+/**
+ * @brief Weights of a 3x3 stencil, symmetric
+ *
+ * new = center * c + edge * (n + s + e + w) + corner * (ne + nw + se + sw)
+ *       + source
+ * With corner == 0 the cheaper 5 point kernel is used.
+ */
+struct StencilWeights
+{
+    StencilWeights() : center(1), edge(0), corner(0) {}
+    StencilWeights(float center, float edge, float corner) : center(center), edge(edge), corner(corner) {}
+
+    /**
+     * @brief Explicit diffusion step with exponential decay
+     *
+     * @param rate diffused share towards each side, below 0.25 for stability
+     * @param decay share lost at every step
+     */
+    static StencilWeights diffusion(float rate, float decay) {
+        const float keep = 1.0f - decay;
+        return StencilWeights((1.0f - 4.0f * rate) * keep, rate * keep, 0.0f);
+    }
+
+    float center;
+    float edge;
+    float corner;
+};
+
+/**
+ * @brief Scalar field over the city map (pollution, land value, noise...)
+ * advanced by a 3x3 stencil
+ *
+ * The grid is double buffered: step() reads one buffer and writes the
+ * other, so tiles can be computed in any order, in parallel on the
+ * JobSystem. Each tile is a block small enough to stay in cache while its
+ * rows are computed, 4 cells at a time with SSE.
+ *
+ * A tile whose cells changed less than the convergence threshold for two
+ * steps in a row, with all its neighbours in the same state, is skipped:
+ * both buffers already hold its values. Editing a cell or a source wakes
+ * its tile up again.
+ *
+ * Cells outside the map hold the boundary value.
+ */
+class FieldGrid
+{
+public:
+    FieldGrid(int width, int height, float boundary = 0.0f, int tileSize = 64);
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+
+    void setWeights(const StencilWeights &weights) { this->weights = weights; wakeAll(); }
+    void setConvergenceThreshold(float threshold) { this->threshold = threshold; }
+
+    float get(int x, int y) const { return buffers[current][index(x, y)]; }
+    void set(int x, int y, float value);
+    /** Amount added to the cell at every step, e.g. emissions */
+    void setSource(int x, int y, float value);
+    /** Row "y" of the current values, "width" floats */
+    const float* getRow(int y) const { return &buffers[current][index(0, y)]; }
+
+    void step(JobSystem *jobs = nullptr);
+
+    /** Cells computed by the last step() */
+    long getUpdatedCells() const { return updatedCells; }
+    int getSkippedTiles() const { return skippedTiles; }
+    int getTileCount() const { return tilesX * tilesY; }
+    /** Cells computed per second of step(), since construction */
+    double getCellsPerSecond() const { return totalSeconds > 0 ? double(totalCells) / totalSeconds : 0.0; }
+
+private:
+    int index(int x, int y) const { return (y + 1) * pitch + x + 1; }
+    int tileOf(int x, int y) const { return (y / tileSize) * tilesX + x / tileSize; }
+    void wake(int tile) { stableSteps[tile] = 0; }
+    void wakeAll();
+    bool canSkip(int tile) const;
+    /** Computes "tile" into the other buffer, returns its largest change */
+    float computeTile(int tile) const;
+
+    int width, height;
+    int pitch;              // floats per row, with the border
+    int tileSize;
+    int tilesX, tilesY;
+
+    std::vector<float> buffers[2];
+    int current;
+    std::vector<float> sources;     // same layout, empty if none
+
+    StencilWeights weights;
+    float threshold;
+
+    std::vector<int> stableSteps;   // per tile
+    std::vector<float> tileChange;
+    std::vector<int> activeTiles;
+
+    long updatedCells;
+    int skippedTiles;
+    long long totalCells;
+    double totalSeconds;
+};
+
+}
+
+#endif // SM_FIELDGRID_H
@@ -0,0 +1,154 @@
+/*
+ * Example of the OpenGL usage with SDL2
+ * Copyright (C) 2013 Matteo De Carlo <matteo.dek@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "inputlog.h"
+#include "../errorhandling.h"
+#include <cstring>
+#include <iterator>
+
+using namespace sm;
+
+namespace {
+    const char MAGIC[4] = { 'S', 'M', 'I', 'L' };
+    const uint32_t VERSION = 1;
+    // magic, version, seed, tick length
+    const size_t HEADER_SIZE = 4 + 4 + 8 + 4;
+}
+
+const uint16_t InputCommand::CHECKSUM;
+
+InputRecorder::InputRecorder(const std::string &path, uint64_t seed, float tickSeconds)
+    : stream(path.c_str(), std::ios_base::out | std::ios_base::binary | std::ios_base::trunc), lastTick(0)
+{
+    if (!stream) {
+        emitError("could not create input log " + path);
+        return;
+    }
+
+    // little endian, like every platform we run on
+    stream.write(MAGIC, sizeof(MAGIC));
+    stream.write(reinterpret_cast<const char*>(&VERSION), sizeof(VERSION));
+    stream.write(reinterpret_cast<const char*>(&seed), sizeof(seed));
+    stream.write(reinterpret_cast<const char*>(&tickSeconds), sizeof(tickSeconds));
+}
+
+InputRecorder::~InputRecorder()
+{
+    close();
+}
+
+void InputRecorder::writeVarint(uint64_t value)
+{
+    while (value >= 0x80) {
+        stream.put(char((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    stream.put(char(value));
+}
+
+void InputRecorder::record(uint32_t tick, uint16_t type, const void *data, size_t size)
+{
+    if (!stream.is_open())
+        return;
+
+    writeVarint(tick - lastTick);
+    writeVarint(type);
+    writeVarint(size);
+    stream.write(static_cast<const char*>(data), std::streamsize(size));
+    lastTick = tick;
+}
+
+void InputRecorder::close()
+{
+    if (stream.is_open())
+        stream.close();
+}
+
+InputLogReader::InputLogReader(const std::string &path)
+    : position(0), valid(false), seed(0), tickSeconds(0), lastTick(0)
+{
+    std::ifstream stream(path.c_str(), std::ios_base::in | std::ios_base::binary);
+    if (!stream) {
+        emitError("could not open input log " + path);
+        return;
+    }
+    data.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+
+    uint32_t version = 0;
+    if (data.size() < HEADER_SIZE || memcmp(data.data(), MAGIC, sizeof(MAGIC)) != 0) {
+        emitError(path + " is not an input log");
+        return;
+    }
+    memcpy(&version, &data[4], sizeof(version));
+    if (version != VERSION) {
+        emitError(path + ": unsupported input log version");
+        return;
+    }
+    memcpy(&seed, &data[8], sizeof(seed));
+    memcpy(&tickSeconds, &data[16], sizeof(tickSeconds));
+    position = HEADER_SIZE;
+    valid = true;
+}
+
+bool InputLogReader::readVarint(uint64_t &value)
+{
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (position >= data.size())
+            return false;
+        const uint8_t byte = data[position++];
+        value |= uint64_t(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0)
+            return true;
+    }
+    return false;
+}
+
+bool InputLogReader::peekTick(uint32_t &tick)
+{
+    const size_t saved = position;
+    uint64_t delta;
+    const bool found = valid && readVarint(delta);
+    position = saved;
+    if (found)
+        tick = lastTick + uint32_t(delta);
+    return found;
+}
+
+bool InputLogReader::next(InputCommand &command)
+{
+    if (!valid)
+        return false;
+
+    uint64_t delta, type, size;
+    if (!readVarint(delta) || !readVarint(type) || !readVarint(size))
+        return false;
+    if (size > data.size() - position) {
+        emitError("truncated input log");
+        valid = false;
+        return false;
+    }
+
+    lastTick += uint32_t(delta);
+    command.tick = lastTick;
+    command.type = uint16_t(type);
+    command.payload.assign(data.begin() + position, data.begin() + position + size);
+    position += size;
+    return true;
+}
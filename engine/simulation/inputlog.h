@@ -0,0 +1,99 @@
+/*
+ * Example of the OpenGL usage with SDL2
+ * Copyright (C) 2013 Matteo De Carlo <matteo.dek@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef SM_INPUTLOG_H
+#define SM_INPUTLOG_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace sm {
+
+/** A player command, applied at the start of "tick" */
+struct InputCommand
+{
+    /** Reserved type, a state checksum written by SimulationDriver */
+    static const uint16_t CHECKSUM = 0xFFFF;
+
+    uint32_t tick;
+    uint16_t type;
+    std::vector<uint8_t> payload;
+};
+
+/**
+ * @brief Writes the commands of a session to a compact binary log
+ *
+ * After a header (magic, version, seed, tick length) every command takes
+ * the tick delta from the previous one, its type and its payload size as
+ * variable length integers, then the payload: usually a few bytes.
+ */
+class InputRecorder
+{
+public:
+    InputRecorder(const std::string &path, uint64_t seed, float tickSeconds);
+    ~InputRecorder();
+
+    bool isOpen() const { return stream.is_open() && stream.good(); }
+
+    /** Commands must be recorded in tick order */
+    void record(uint32_t tick, uint16_t type, const void *data, size_t size);
+    void record(const InputCommand &command) {
+        record(command.tick, command.type, command.payload.data(), command.payload.size());
+    }
+    void close();
+
+private:
+    void writeVarint(uint64_t value);
+
+    std::ofstream stream;
+    uint32_t lastTick;
+};
+
+/** Reads back a log written by InputRecorder */
+class InputLogReader
+{
+public:
+    explicit InputLogReader(const std::string &path);
+
+    /** false if the file is missing or not an input log */
+    bool isValid() const { return valid; }
+    uint64_t getSeed() const { return seed; }
+    float getTickSeconds() const { return tickSeconds; }
+
+    /** Next command, false at the end of the log */
+    bool next(InputCommand &command);
+    /** Tick of the next command without consuming it, false at the end */
+    bool peekTick(uint32_t &tick);
+
+private:
+    bool readVarint(uint64_t &value);
+
+    std::vector<uint8_t> data;
+    size_t position;
+    bool valid;
+    uint64_t seed;
+    float tickSeconds;
+    uint32_t lastTick;
+};
+
+}
+
+#endif // SM_INPUTLOG_H
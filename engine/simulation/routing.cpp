@@ -0,0 +1,390 @@
+/*
+ * Example of the OpenGL usage with SDL2
+ * Copyright (C) 2013 Matteo De Carlo <matteo.dek@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "routing.h"
+#include "../jobs/jobsystem.h"
+#include <algorithm>
+#include <functional>
+#include <limits>
+
+using namespace sm;
+
+namespace {
+    const float INFINITE = std::numeric_limits<float>::infinity();
+    const size_t DEFAULT_CACHE_CAPACITY = 4096;
+
+    typedef std::pair<float, int> HeapItem;
+    typedef std::greater<HeapItem> HeapOrder;   // smallest first
+}
+
+RoutingService::RoutingService()
+    : cacheCapacity(DEFAULT_CACHE_CAPACITY), cacheHits(0), cacheMisses(0), settledCount(0)
+{
+}
+
+int RoutingService::addNode(int zone)
+{
+    const int node = int(outEdges.size());
+    outEdges.push_back(std::vector<int>());
+    inEdges.push_back(std::vector<int>());
+    for (size_t l = 0; l < landmarks.size(); l++) {
+        // not connected yet
+        fromLandmark[l].push_back(INFINITE);
+        toLandmark[l].push_back(INFINITE);
+    }
+
+    if (zone >= 0 && getZoneNode(zone) < 0)
+        setZoneNode(zone, node);
+    return node;
+}
+
+void RoutingService::setZoneNode(int zone, int node)
+{
+    if (zone >= int(zoneNode.size()))
+        zoneNode.resize(zone + 1, -1);
+    zoneNode[zone] = node;
+
+    // the cached routes of the zone start or end somewhere else now
+    for (std::list<CacheEntry>::iterator it = cache.begin(); it != cache.end(); ) {
+        if (int(it->key >> 32) == zone || int(uint32_t(it->key)) == zone) {
+            cacheIndex.erase(it->key);
+            it = cache.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+int RoutingService::addEdge(int from, int to, float cost)
+{
+    Edge edge;
+    edge.from = from;
+    edge.to = to;
+    edge.cost = cost;
+    edge.removed = false;
+    const int index = int(edges.size());
+    edges.push_back(edge);
+    outEdges[from].push_back(index);
+    inEdges[to].push_back(index);
+
+    for (size_t l = 0; l < landmarks.size(); l++) {
+        std::vector<float> &forward = fromLandmark[l];
+        if (forward[from] + cost < forward[to]) {
+            forward[to] = forward[from] + cost;
+            propagateDecrease(to, true, forward);
+        }
+        std::vector<float> &backward = toLandmark[l];
+        if (cost + backward[to] < backward[from]) {
+            backward[from] = cost + backward[to];
+            propagateDecrease(from, false, backward);
+        }
+    }
+
+    invalidateAfterAdd(edge);
+    return index;
+}
+
+void RoutingService::removeEdge(int index)
+{
+    Edge &edge = edges[index];
+    if (edge.removed)
+        return;
+    edge.removed = true;
+
+    std::vector<int> &out = outEdges[edge.from];
+    out.erase(std::find(out.begin(), out.end(), index));
+    std::vector<int> &in = inEdges[edge.to];
+    in.erase(std::find(in.begin(), in.end(), index));
+
+    // landmark distances are still valid lower bounds
+    invalidateAfterRemove(index);
+}
+
+void RoutingService::landmarkDistances(int source, bool forward, std::vector<float> &distance) const
+{
+    distance.assign(outEdges.size(), INFINITE);
+    distance[source] = 0.0f;
+    propagateDecrease(source, forward, distance);
+}
+
+void RoutingService::propagateDecrease(int node, bool forward, std::vector<float> &distance) const
+{
+    std::vector<HeapItem> heap;
+    heap.push_back(HeapItem(distance[node], node));
+
+    while (!heap.empty()) {
+        std::pop_heap(heap.begin(), heap.end(), HeapOrder());
+        const HeapItem top = heap.back();
+        heap.pop_back();
+        if (top.first > distance[top.second])
+            continue;   // stale
+
+        const std::vector<int> &adjacent = forward ? outEdges[top.second] : inEdges[top.second];
+        for (size_t i = 0; i < adjacent.size(); i++) {
+            const Edge &edge = edges[adjacent[i]];
+            const int next = forward ? edge.to : edge.from;
+            const float candidate = top.first + edge.cost;
+            if (candidate < distance[next]) {
+                distance[next] = candidate;
+                heap.push_back(HeapItem(candidate, next));
+                std::push_heap(heap.begin(), heap.end(), HeapOrder());
+            }
+        }
+    }
+}
+
+void RoutingService::buildLandmarks(int count)
+{
+    landmarks.clear();
+    fromLandmark.clear();
+    toLandmark.clear();
+    const int nodeCount = getNodeCount();
+    if (nodeCount == 0)
+        return;
+
+    // farthest point selection: each landmark is the node farthest from
+    // the ones already picked
+    std::vector<float> closest(nodeCount, INFINITE);
+    int next = 0;
+    for (int l = 0; l < count && l < nodeCount; l++) {
+        landmarks.push_back(next);
+        fromLandmark.push_back(std::vector<float>());
+        toLandmark.push_back(std::vector<float>());
+        landmarkDistances(next, true, fromLandmark.back());
+        landmarkDistances(next, false, toLandmark.back());
+
+        float farthest = -1.0f;
+        for (int node = 0; node < nodeCount; node++) {
+            const float distance = std::min(fromLandmark.back()[node], toLandmark.back()[node]);
+            closest[node] = std::min(closest[node], distance);
+            // unreachable nodes would make useless landmarks
+            if (closest[node] != INFINITE && closest[node] > farthest) {
+                farthest = closest[node];
+                next = node;
+            }
+        }
+        if (farthest <= 0.0f)
+            break;
+    }
+}
+
+float RoutingService::lowerBound(int from, int to) const
+{
+    float bound = 0.0f;
+    for (size_t l = 0; l < landmarks.size(); l++) {
+        // d(L, to) - d(L, from) <= d(from, to)
+        const float *forward = fromLandmark[l].data();
+        if (forward[from] != INFINITE)
+            bound = std::max(bound, forward[to] - forward[from]);
+        // d(from, L) - d(to, L) <= d(from, to)
+        const float *backward = toLandmark[l].data();
+        if (backward[to] != INFINITE)
+            bound = std::max(bound, backward[from] - backward[to]);
+    }
+    return bound;
+}
+
+RoutingService::RoutePtr RoutingService::search(int origin, int destination, Search &state) const
+{
+    std::shared_ptr<Route> route(new Route);
+    route->found = false;
+    route->cost = INFINITE;
+    if (origin < 0 || destination < 0)
+        return route;
+
+    const size_t nodeCount = outEdges.size();
+    if (state.distance.size() != nodeCount) {
+        state.distance.assign(nodeCount, INFINITE);
+        state.parentEdge.assign(nodeCount, -1);
+        state.stamp.assign(nodeCount, 0);
+        state.current = 0;
+    }
+    state.current++;
+    state.heap.clear();
+
+    state.distance[origin] = 0.0f;
+    state.parentEdge[origin] = -1;
+    state.stamp[origin] = state.current;
+    state.heap.push_back(HeapItem(lowerBound(origin, destination), origin));
+
+    while (!state.heap.empty()) {
+        std::pop_heap(state.heap.begin(), state.heap.end(), HeapOrder());
+        const HeapItem top = state.heap.back();
+        state.heap.pop_back();
+        const int node = top.second;
+        const float distance = state.distance[node];
+        if (top.first > distance + lowerBound(node, destination))
+            continue;   // stale
+        state.settled++;
+        if (node == destination)
+            break;
+
+        const std::vector<int> &out = outEdges[node];
+        for (size_t i = 0; i < out.size(); i++) {
+            const Edge &edge = edges[out[i]];
+            const float candidate = distance + edge.cost;
+            if (state.stamp[edge.to] == state.current && candidate >= state.distance[edge.to])
+                continue;
+            const float bound = lowerBound(edge.to, destination);
+            if (bound == INFINITE)
+                continue;
+            state.stamp[edge.to] = state.current;
+            state.distance[edge.to] = candidate;
+            state.parentEdge[edge.to] = out[i];
+            state.heap.push_back(HeapItem(candidate + bound, edge.to));
+            std::push_heap(state.heap.begin(), state.heap.end(), HeapOrder());
+        }
+    }
+
+    if (state.stamp[destination] != state.current)
+        return route;
+
+    route->found = true;
+    route->cost = state.distance[destination];
+    for (int node = destination; node != origin; node = edges[state.parentEdge[node]].from) {
+        route->nodes.push_back(node);
+        route->edges.push_back(state.parentEdge[node]);
+    }
+    route->nodes.push_back(origin);
+    std::reverse(route->nodes.begin(), route->nodes.end());
+    std::reverse(route->edges.begin(), route->edges.end());
+    return route;
+}
+
+RoutingService::RoutePtr RoutingService::findRoute(int originZone, int destinationZone)
+{
+    std::vector<RouteQuery> queries(1);
+    queries[0].originZone = originZone;
+    queries[0].destinationZone = destinationZone;
+    std::vector<RoutePtr> results;
+    findRoutes(queries, results);
+    return results[0];
+}
+
+void RoutingService::findRoutes(const std::vector<RouteQuery> &queries, std::vector<RoutePtr> &results, JobSystem *jobs)
+{
+    results.resize(queries.size());
+
+    // cache hits, and the distinct misses
+    std::vector<uint64_t> missKeys;
+    std::unordered_map<uint64_t, int> missIndex;
+    std::vector<int> queryMiss(queries.size(), -1);
+    for (size_t q = 0; q < queries.size(); q++) {
+        const uint64_t key = cacheKey(queries[q].originZone, queries[q].destinationZone);
+        RoutePtr cached = lookup(key);
+        if (cached) {
+            results[q] = cached;
+            cacheHits++;
+            continue;
+        }
+        std::unordered_map<uint64_t, int>::iterator found = missIndex.find(key);
+        if (found == missIndex.end()) {
+            found = missIndex.insert(std::make_pair(key, int(missKeys.size()))).first;
+            missKeys.push_back(key);
+        }
+        queryMiss[q] = found->second;
+    }
+    cacheMisses += long(missKeys.size());
+
+    // the searches only read the graph
+    std::vector<RoutePtr> solved(missKeys.size());
+    std::vector<long> settled(missKeys.size(), 0);
+    const std::function<void(int, int)> solve = [&](int begin, int end) {
+        Search state;
+        state.current = 0;
+        for (int m = begin; m < end; m++) {
+            state.settled = 0;
+            solved[m] = search(getZoneNode(int(missKeys[m] >> 32)), getZoneNode(int(uint32_t(missKeys[m]))), state);
+            settled[m] = state.settled;
+        }
+    };
+    if (jobs != nullptr)
+        jobs->parallelFor(0, int(missKeys.size()), solve);
+    else
+        solve(0, int(missKeys.size()));
+
+    for (size_t m = 0; m < missKeys.size(); m++) {
+        store(missKeys[m], getZoneNode(int(missKeys[m] >> 32)), getZoneNode(int(uint32_t(missKeys[m]))), solved[m]);
+        settledCount += settled[m];
+    }
+    for (size_t q = 0; q < queries.size(); q++) {
+        if (queryMiss[q] >= 0)
+            results[q] = solved[queryMiss[q]];
+    }
+}
+
+void RoutingService::setCacheCapacity(size_t capacity)
+{
+    cacheCapacity = capacity;
+    while (cache.size() > cacheCapacity) {
+        cacheIndex.erase(cache.back().key);
+        cache.pop_back();
+    }
+}
+
+RoutingService::RoutePtr RoutingService::lookup(uint64_t key)
+{
+    std::unordered_map<uint64_t, std::list<CacheEntry>::iterator>::iterator found = cacheIndex.find(key);
+    if (found == cacheIndex.end())
+        return RoutePtr();
+    // most recently used to the front
+    cache.splice(cache.begin(), cache, found->second);
+    return found->second->route;
+}
+
+void RoutingService::store(uint64_t key, int origin, int destination, const RoutePtr &route)
+{
+    if (cacheCapacity == 0 || cacheIndex.count(key) != 0)
+        return;
+
+    CacheEntry entry;
+    entry.key = key;
+    entry.origin = origin;
+    entry.destination = destination;
+    entry.route = route;
+    cache.push_front(entry);
+    cacheIndex[key] = cache.begin();
+    setCacheCapacity(cacheCapacity);
+}
+
+void RoutingService::invalidateAfterAdd(const Edge &edge)
+{
+    for (std::list<CacheEntry>::iterator it = cache.begin(); it != cache.end(); ) {
+        if (it->origin >= 0 && it->destination >= 0 &&
+            lowerBound(it->origin, edge.from) + edge.cost + lowerBound(edge.to, it->destination) < it->route->cost) {
+            cacheIndex.erase(it->key);
+            it = cache.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void RoutingService::invalidateAfterRemove(int edge)
+{
+    for (std::list<CacheEntry>::iterator it = cache.begin(); it != cache.end(); ) {
+        const std::vector<int> &used = it->route->edges;
+        if (std::find(used.begin(), used.end(), edge) != used.end()) {
+            cacheIndex.erase(it->key);
+            it = cache.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
@@ -0,0 +1,161 @@
+/*
+ * Example of the OpenGL usage with SDL2
+ * Copyright (C) 2013 Matteo De Carlo <matteo.dek@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef SM_ROUTING_H
+#define SM_ROUTING_H
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace sm {
+
+class JobSystem;
+
+/**
+ * @brief Shortest paths between zones of the road graph
+ *
+ * Queries run A* guided by ALT lower bounds: the distances from and to a
+ * few landmark nodes give, through the triangle inequality, a lower bound
+ * of the distance between any two nodes. Landmarks are computed once by
+ * buildLandmarks() and kept valid as the graph changes:
+ *  - adding an edge can only shorten distances, so the landmark distances
+ *    are lowered by a Dijkstra limited to the nodes that improve;
+ *  - removing an edge can only lengthen distances, and bounds computed on a
+ *    larger graph are still lower bounds, so nothing is recomputed.
+ *
+ * Routes are cached by (origin zone, destination zone), least recently
+ * used evicted first. Adding an edge u->v drops the routes that it could
+ * shorten, i.e. bound(origin, u) + cost + bound(v, destination) < route
+ * cost; removing an edge drops the routes using it.
+ */
+class RoutingService
+{
+public:
+    struct Route {
+        bool  found;
+        float cost;
+        std::vector<int> nodes;  // origin first
+        std::vector<int> edges;
+    };
+    typedef std::shared_ptr<const Route> RoutePtr;
+
+    struct RouteQuery {
+        int originZone;
+        int destinationZone;
+    };
+
+    RoutingService();
+
+    /** @param zone zone of the node, the first node of a zone represents it */
+    int addNode(int zone = -1);
+    /** Makes "node" the node routes of "zone" start and end at */
+    void setZoneNode(int zone, int node);
+    /** Directed road segment, a built road */
+    int addEdge(int from, int to, float cost);
+    /** A removed road */
+    void removeEdge(int edge);
+
+    int getNodeCount() const { return int(outEdges.size()); }
+
+    /** Picks "count" landmarks far from each other and computes their distances */
+    void buildLandmarks(int count);
+    int getLandmarkCount() const { return int(landmarks.size()); }
+
+    /** Lower bound of the distance from "from" to "to", infinite if unreachable */
+    float lowerBound(int from, int to) const;
+
+    int getZoneNode(int zone) const { return zone >= 0 && zone < int(zoneNode.size()) ? zoneNode[zone] : -1; }
+
+    RoutePtr findRoute(int originZone, int destinationZone);
+    /**
+     * @brief Answers many queries at once
+     *
+     * Cache misses are deduplicated and searched in parallel on "jobs" if
+     * not null; results[i] answers queries[i].
+     */
+    void findRoutes(const std::vector<RouteQuery> &queries, std::vector<RoutePtr> &results, JobSystem *jobs = nullptr);
+
+    void setCacheCapacity(size_t capacity);
+    size_t getCacheSize() const { return cache.size(); }
+    long getCacheHits() const { return cacheHits; }
+    long getCacheMisses() const { return cacheMisses; }
+    /** Nodes settled by the searches, to measure the landmarks benefit */
+    long getSettledCount() const { return settledCount; }
+
+private:
+    struct Edge {
+        int from, to;
+        float cost;
+        bool removed;
+    };
+
+    /** Per thread search state, reused across searches */
+    struct Search {
+        std::vector<float> distance;
+        std::vector<int> parentEdge;
+        std::vector<unsigned int> stamp;  // == current if distance is valid
+        unsigned int current;
+        std::vector<std::pair<float, int> > heap;
+        long settled;
+    };
+
+    struct CacheEntry {
+        uint64_t key;
+        int origin, destination;    // nodes
+        RoutePtr route;
+    };
+
+    static uint64_t cacheKey(int originZone, int destinationZone) {
+        return (uint64_t(uint32_t(originZone)) << 32) | uint32_t(destinationZone);
+    }
+
+    RoutePtr search(int origin, int destination, Search &state) const;
+    /** Dijkstra from "source" over out edges (forward) or in edges */
+    void landmarkDistances(int source, bool forward, std::vector<float> &distance) const;
+    /** Lowers "distance" starting from "node" whose distance just decreased */
+    void propagateDecrease(int node, bool forward, std::vector<float> &distance) const;
+
+    RoutePtr lookup(uint64_t key);
+    void store(uint64_t key, int origin, int destination, const RoutePtr &route);
+    void invalidateAfterAdd(const Edge &edge);
+    void invalidateAfterRemove(int edge);
+
+    std::vector<Edge> edges;
+    std::vector<std::vector<int> > outEdges;
+    std::vector<std::vector<int> > inEdges;
+    std::vector<int> zoneNode;      // -1 if the zone has no node
+
+    std::vector<int> landmarks;
+    std::vector<std::vector<float> > fromLandmark;  // [landmark][node]
+    std::vector<std::vector<float> > toLandmark;
+
+    std::list<CacheEntry> cache;    // most recently used first
+    std::unordered_map<uint64_t, std::list<CacheEntry>::iterator> cacheIndex;
+    size_t cacheCapacity;
+    long cacheHits;
+    long cacheMisses;
+    long settledCount;
+};
+
+}
+
+#endif // SM_ROUTING_H
@@ -0,0 +1,183 @@
+/*
+ * Example of the OpenGL usage with SDL2
+ * Copyright (C) 2013 Matteo De Carlo <matteo.dek@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "simulationdriver.h"
+#include "../errorhandling.h"
+#include "../timer.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace sm;
+
+SimulationDriver::SimulationDriver(uint64_t seed, float tickSeconds)
+    : seed(seed), tickSeconds(tickSeconds), currentTick(0), random(seed), checksumInterval(0),
+      recorder(nullptr), replaying(false), divergedTick(-1)
+{
+}
+
+int SimulationDriver::addSystem(const std::string &name, const System &system)
+{
+    SystemEntry entry;
+    entry.name = name;
+    entry.function = system;
+    entry.totalSeconds = 0;
+    entry.maxSeconds = 0;
+    systems.push_back(entry);
+    return int(systems.size()) - 1;
+}
+
+void SimulationDriver::setChecksum(const Checksum &checksum, uint32_t interval)
+{
+    this->checksum = checksum;
+    checksumInterval = interval;
+}
+
+void SimulationDriver::submitCommand(uint16_t type, const void *data, size_t size)
+{
+    // the log drives the session while replaying
+    if (replaying)
+        return;
+
+    InputCommand command;
+    command.tick = currentTick;
+    command.type = type;
+    command.payload.assign(static_cast<const uint8_t*>(data), static_cast<const uint8_t*>(data) + size);
+    if (recorder != nullptr)
+        recorder->record(command);
+    pending.push_back(command);
+}
+
+void SimulationDriver::applyCommand(const InputCommand &command)
+{
+    if (command.type == InputCommand::CHECKSUM)
+        return;
+    if (commandHandler)
+        commandHandler(command);
+}
+
+void SimulationDriver::tick()
+{
+    Timer tickTimer;
+
+    while (!pending.empty() && pending.front().tick <= currentTick) {
+        applyCommand(pending.front());
+        pending.pop_front();
+    }
+
+    Timer systemTimer;
+    for (size_t s = 0; s < systems.size(); s++) {
+        systemTimer.reset();
+        systems[s].function(currentTick, tickSeconds);
+        const double seconds = systemTimer.getElapsedSeconds();
+        systems[s].totalSeconds += seconds;
+        systems[s].maxSeconds = std::max(systems[s].maxSeconds, seconds);
+    }
+
+    currentTick++;
+    tickTimes.push_back(float(tickTimer.getElapsedSeconds()));
+
+    if (recorder != nullptr && checksum && checksumInterval > 0 && currentTick % checksumInterval == 0) {
+        // state after "tick" ticks, stored with the commands of the next one
+        const uint64_t value = checksum();
+        recorder->record(currentTick, InputCommand::CHECKSUM, &value, sizeof(value));
+    }
+}
+
+bool SimulationDriver::checkChecksum(const InputCommand &command)
+{
+    uint64_t expected;
+    if (!checksum || command.payload.size() != sizeof(expected))
+        return true;
+    memcpy(&expected, command.payload.data(), sizeof(expected));
+    if (checksum() == expected)
+        return true;
+    divergedTick = long(command.tick);
+    return false;
+}
+
+bool SimulationDriver::replay(InputLogReader &log, uint32_t tickCount)
+{
+    divergedTick = -1;
+    if (log.getSeed() != seed || log.getTickSeconds() != tickSeconds) {
+        emitError("input log recorded with a different seed or tick length");
+        return false;
+    }
+
+    replaying = true;
+    InputRecorder *savedRecorder = recorder;
+    recorder = nullptr;
+
+    const uint32_t end = currentTick + tickCount;
+    InputCommand command;
+    uint32_t nextTick;
+    bool matching = true;
+    while (tickCount == 0 || currentTick < end) {
+        // commands due before the coming tick
+        while (log.peekTick(nextTick) && nextTick <= currentTick) {
+            log.next(command);
+            if (command.type != InputCommand::CHECKSUM)
+                pending.push_back(command);
+            else if (!checkChecksum(command))
+                matching = false;
+        }
+        if (!matching)
+            break;
+        if (tickCount == 0 && pending.empty() && !log.peekTick(nextTick))
+            break;
+        tick();
+    }
+
+    recorder = savedRecorder;
+    replaying = false;
+    return matching;
+}
+
+void SimulationDriver::report(std::ostream &out) const
+{
+    out<<"ticks: "<<tickTimes.size();
+    if (!tickTimes.empty()) {
+        std::vector<float> sorted(tickTimes);
+        std::sort(sorted.begin(), sorted.end());
+        double total = 0;
+        for (size_t i = 0; i < sorted.size(); i++)
+            total += sorted[i];
+        out<<" mean "<<total / sorted.size() * 1000.0<<" ms"
+           <<" p50 "<<sorted[sorted.size() / 2] * 1000.0<<" ms"
+           <<" p99 "<<sorted[std::min(sorted.size() - 1, sorted.size() * 99 / 100)] * 1000.0<<" ms"
+           <<" max "<<sorted.back() * 1000.0<<" ms";
+    }
+    out<<std::endl;
+
+    for (size_t s = 0; s < systems.size(); s++) {
+        const SystemEntry &system = systems[s];
+        out<<"  "<<system.name<<": total "<<system.totalSeconds * 1000.0<<" ms";
+        if (!tickTimes.empty())
+            out<<" mean "<<system.totalSeconds / tickTimes.size() * 1000.0<<" ms";
+        out<<" max "<<system.maxSeconds * 1000.0<<" ms"<<std::endl;
+    }
+}
+
+void SimulationDriver::resetStatistics()
+{
+    tickTimes.clear();
+    for (size_t s = 0; s < systems.size(); s++) {
+        systems[s].totalSeconds = 0;
+        systems[s].maxSeconds = 0;
+    }
+}
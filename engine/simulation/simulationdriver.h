@@ -0,0 +1,124 @@
+/*
+ * Example of the OpenGL usage with SDL2
+ * Copyright (C) 2013 Matteo De Carlo <matteo.dek@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef SM_SIMULATIONDRIVER_H
+#define SM_SIMULATIONDRIVER_H
+
+#include "deterministic.h"
+#include "inputlog.h"
+#include <deque>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace sm {
+
+/**
+ * @brief Fixed step simulation loop, deterministic and measurable
+ *
+ * Every tick first applies the commands due at that tick, in submission
+ * order, then runs the systems in the order they were added, with the same
+ * "dt". Given the same seed and the same commands a session replays
+ * exactly, as long as the systems draw from Random (split from getRandom())
+ * and reduce floats with deterministicSum().
+ *
+ * Commands submitted while recording are written to an InputRecorder;
+ * replay() feeds them back, without a window, and the per system Timer
+ * measurements of report() become a benchmark of the engine build.
+ * With a checksum function the recorded session also stores the state
+ * checksum every few ticks, and replay() stops at the first divergence.
+ */
+class SimulationDriver
+{
+public:
+    typedef std::function<void(uint32_t tick, float dt)> System;
+    typedef std::function<void(const InputCommand &command)> CommandHandler;
+    typedef std::function<uint64_t()> Checksum;
+
+    SimulationDriver(uint64_t seed, float tickSeconds);
+
+    /** Master generator, systems should keep a split() of it */
+    Random& getRandom() { return random; }
+    uint64_t getSeed() const { return seed; }
+    float getTickSeconds() const { return tickSeconds; }
+    uint32_t getTick() const { return currentTick; }
+
+    int addSystem(const std::string &name, const System &system);
+    void setCommandHandler(const CommandHandler &handler) { commandHandler = handler; }
+    /** "checksum" is recorded, or verified on replay, every "interval" ticks */
+    void setChecksum(const Checksum &checksum, uint32_t interval);
+
+    /** Records the commands submitted from now on, null to stop */
+    void setRecorder(InputRecorder *recorder) { this->recorder = recorder; }
+
+    /** Queues a command, applied at the start of the next tick. Ignored during replay() */
+    void submitCommand(uint16_t type, const void *data, size_t size);
+
+    void tick();
+
+    /**
+     * @brief Runs a recorded session headless
+     *
+     * The driver must be built with the seed and tick length of the log.
+     *
+     * @param tickCount ticks to run, 0 until the last command of the log
+     * @return bool false if a checksum didn't match, see getDivergedTick(),
+     * or if the log was recorded with another seed or tick length
+     */
+    bool replay(InputLogReader &log, uint32_t tickCount = 0);
+    /** Tick of the first checksum mismatch of the last replay(), or -1 */
+    long getDivergedTick() const { return divergedTick; }
+
+    /** Per tick and per system timings since the last reset */
+    void report(std::ostream &out) const;
+    void resetStatistics();
+
+private:
+    struct SystemEntry {
+        std::string name;
+        System function;
+        double totalSeconds;
+        double maxSeconds;
+    };
+
+    void applyCommand(const InputCommand &command);
+    bool checkChecksum(const InputCommand &command);
+
+    uint64_t seed;
+    float tickSeconds;
+    uint32_t currentTick;
+    Random random;
+
+    std::vector<SystemEntry> systems;
+    CommandHandler commandHandler;
+    Checksum checksum;
+    uint32_t checksumInterval;
+
+    std::deque<InputCommand> pending;
+    InputRecorder *recorder;
+    bool replaying;
+    long divergedTick;
+
+    std::vector<float> tickTimes;   // seconds, per tick
+};
+
+}
+
+#endif // SM_SIMULATIONDRIVER_H
@@ -0,0 +1,138 @@
+/*
+ * Example of the OpenGL usage with SDL2
+ * Copyright (C) 2013 Matteo De Carlo <matteo.dek@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "simulationlod.h"
+#include "../jobs/jobsystem.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace sm;
+
+void DistrictAggregate::step(double seconds)
+{
+    // exponential relaxation towards the demand, stable for any step
+    const double demand = population * tripRate;
+    const double blend = 1.0 - std::exp(-seconds / relaxationSeconds);
+    vehicles += (demand - vehicles) * blend;
+
+    const double density = std::min(getDensity(), jamDensity);
+    averageSpeed = freeSpeed * (1.0 - density / jamDensity);
+}
+
+SimulationLod::SimulationLod(RegionSimulator &simulator)
+    : simulator(simulator), tickCount(0), detailedCount(0)
+{
+}
+
+int SimulationLod::addRegion(const Vector3 &center, float radius, float importance)
+{
+    Region region;
+    const smReal *c = center.data();
+    region.center[0] = c[0];
+    region.center[1] = c[1];
+    region.center[2] = c[2];
+    region.radius = radius;
+    region.importance = importance;
+    region.mode = MODE_DETAILED;
+    region.tickInterval = 1;
+    region.pendingSeconds = 0;
+    regions.push_back(region);
+    detailedCount++;
+    return int(regions.size()) - 1;
+}
+
+float SimulationLod::perceivedDistance(const Region &region, const Vector3 &camera) const
+{
+    const smReal *c = camera.data();
+    const float dx = region.center[0] - c[0];
+    const float dy = region.center[1] - c[1];
+    const float dz = region.center[2] - c[2];
+    const float distance = std::max(0.0f, std::sqrt(dx*dx + dy*dy + dz*dz) - region.radius);
+    return distance / (1.0f + std::max(0.0f, region.importance));
+}
+
+void SimulationLod::update(const Vector3 &camera)
+{
+    detailedCount = 0;
+    for (size_t i = 0; i < regions.size(); i++) {
+        Region &region = regions[i];
+        const float distance = perceivedDistance(region, camera);
+
+        // the interval doubles with the distance
+        int interval = 1;
+        for (float limit = settings.fullRateDistance; distance > limit && interval < settings.maxTickInterval; limit *= 2.0f)
+            interval *= 2;
+        region.tickInterval = interval;
+
+        Mode mode = region.mode;
+        if (mode == MODE_DETAILED && distance > settings.aggregateDistance + settings.hysteresis)
+            mode = MODE_AGGREGATE;
+        else if (mode == MODE_AGGREGATE && distance < settings.aggregateDistance)
+            mode = MODE_DETAILED;
+
+        if (mode != region.mode) {
+            // catch up in the old mode, then hand over the state
+            simulate(int(i));
+            if (mode == MODE_AGGREGATE)
+                simulator.aggregate(int(i), region.aggregate);
+            else
+                simulator.disaggregate(int(i), region.aggregate);
+            region.mode = mode;
+        }
+        if (region.mode == MODE_DETAILED)
+            detailedCount++;
+    }
+}
+
+void SimulationLod::simulate(int index)
+{
+    Region &region = regions[index];
+    const float seconds = region.pendingSeconds;
+    region.pendingSeconds = 0;
+    if (seconds <= 0.0f)
+        return;
+
+    if (region.mode == MODE_DETAILED)
+        simulator.simulateDetailed(index, seconds);
+    else
+        region.aggregate.step(seconds);
+}
+
+void SimulationLod::tick(float seconds, JobSystem *jobs)
+{
+    due.clear();
+    for (size_t i = 0; i < regions.size(); i++) {
+        Region &region = regions[i];
+        region.pendingSeconds += seconds;
+        // the region index spreads the regions over the ticks of the interval
+        if ((tickCount + unsigned(i)) % unsigned(region.tickInterval) == 0)
+            due.push_back(int(i));
+    }
+    tickCount++;
+
+    if (jobs != nullptr) {
+        jobs->parallelFor(0, int(due.size()), [this](int begin, int end) {
+            for (int d = begin; d < end; d++)
+                simulate(due[d]);
+        }, 1);
+    } else {
+        for (size_t d = 0; d < due.size(); d++)
+            simulate(due[d]);
+    }
+}
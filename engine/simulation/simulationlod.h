@@ -0,0 +1,157 @@
+/*
+ * Example of the OpenGL usage with SDL2
+ * Copyright (C) 2013 Matteo De Carlo <matteo.dek@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef SM_SIMULATIONLOD_H
+#define SM_SIMULATIONLOD_H
+
+#include "../math/math.h"
+#include <vector>
+
+namespace sm {
+
+class JobSystem;
+
+/**
+ * @brief District level state used while a region isn't simulated per agent
+ *
+ * Traffic follows a macroscopic model: vehicles on the road relax towards
+ * the trips the population generates, speed follows Greenshields' law
+ * (decreasing linearly with density, zero at jam density).
+ */
+struct DistrictAggregate
+{
+    DistrictAggregate()
+        : population(0), employed(0), vehicles(0), roadKilometers(1), freeSpeed(13.9),
+          jamDensity(150), tripRate(0.05), relaxationSeconds(600), averageSpeed(13.9) {}
+
+    double population;
+    double employed;
+    double vehicles;            // on the road
+    double roadKilometers;      // lane kilometers
+    double freeSpeed;           // m/s
+    double jamDensity;          // vehicles per lane kilometer
+    double tripRate;            // share of the population on the road
+    double relaxationSeconds;
+    double averageSpeed;        // m/s, output
+
+    double getDensity() const { return vehicles / roadKilometers; }
+
+    /** Advances the aggregate model by "seconds" */
+    void step(double seconds);
+};
+
+/**
+ * @brief Per region simulation, implemented by the game
+ */
+class RegionSimulator
+{
+public:
+    virtual ~RegionSimulator() {}
+
+    /** Per agent simulation of "region" for "seconds" */
+    virtual void simulateDetailed(int region, float seconds) = 0;
+    /** Collects the agents of "region" into "aggregate" and drops them */
+    virtual void aggregate(int region, DistrictAggregate &aggregate) = 0;
+    /**
+     * @brief Recreates the agents of "region" matching "aggregate"
+     *
+     * Population and vehicle counts are the targets to reconcile with:
+     * agents kept from before are reused, missing ones spawned, extra ones
+     * removed.
+     */
+    virtual void disaggregate(int region, const DistrictAggregate &aggregate) = 0;
+};
+
+/**
+ * @brief Chooses how often, and how finely, each region is simulated
+ *
+ * Regions near the camera, or important for gameplay, are simulated per
+ * agent every tick. Farther regions are simulated every 2, 4, 8... ticks
+ * with the accumulated time, and beyond the aggregate distance they switch
+ * to their DistrictAggregate, reconciled back to agents when the camera
+ * comes near again. A hysteresis band avoids switching back and forth.
+ *
+ * Regions due in the same tick are independent and run in parallel on the
+ * JobSystem; their phases are spread so that the regions sharing a tick
+ * interval don't all run in the same tick.
+ */
+class SimulationLod
+{
+public:
+    enum Mode {
+        MODE_DETAILED,
+        MODE_AGGREGATE
+    };
+
+    struct Settings {
+        Settings() : fullRateDistance(300), aggregateDistance(1500), hysteresis(200), maxTickInterval(16) {}
+
+        float fullRateDistance;     // every tick within it
+        float aggregateDistance;
+        float hysteresis;
+        int   maxTickInterval;
+    };
+
+    explicit SimulationLod(RegionSimulator &simulator);
+
+    void setSettings(const Settings &settings) { this->settings = settings; }
+
+    int addRegion(const Vector3 &center, float radius, float importance = 0.0f);
+    /** Importance 0 is the default, 1 halves the perceived distance */
+    void setImportance(int region, float importance) { regions[region].importance = importance; }
+    DistrictAggregate& getAggregate(int region) { return regions[region].aggregate; }
+    Mode getMode(int region) const { return regions[region].mode; }
+    int getTickInterval(int region) const { return regions[region].tickInterval; }
+
+    /** Reassigns modes and tick intervals for the camera at "camera" */
+    void update(const Vector3 &camera);
+
+    /** One simulation tick of "seconds", running the regions due */
+    void tick(float seconds, JobSystem *jobs = nullptr);
+
+    int getRegionCount() const { return int(regions.size()); }
+    int getDetailedCount() const { return detailedCount; }
+    /** Regions simulated by the last tick() */
+    int getSimulatedCount() const { return int(due.size()); }
+
+private:
+    struct Region {
+        float center[3];
+        float radius;
+        float importance;
+        Mode  mode;
+        int   tickInterval;
+        float pendingSeconds;     // not simulated yet
+        DistrictAggregate aggregate;
+    };
+
+    void simulate(int region);
+    float perceivedDistance(const Region &region, const Vector3 &camera) const;
+
+    RegionSimulator &simulator;
+    Settings settings;
+    std::vector<Region> regions;
+    std::vector<int> due;
+    unsigned int tickCount;
+    int detailedCount;
+};
+
+}
+
+#endif // SM_SIMULATIONLOD_H
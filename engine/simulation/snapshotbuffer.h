@@ -0,0 +1,113 @@
+/*
+ * Example of the OpenGL usage with SDL2
+ * Copyright (C) 2013 Matteo De Carlo <matteo.dek@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef SM_SNAPSHOTBUFFER_H
+#define SM_SNAPSHOTBUFFER_H
+
+#include "../math/math.h"
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace sm {
+
+/**
+ * @brief Hands snapshots from one writer thread to one reader thread,
+ * without locks and without either ever waiting for the other
+ *
+ * There are three copies of T: the writer fills the back one and
+ * publish()es it, the reader acquire()s the newest published one and reads
+ * it as long as it wants. Both operations just exchange their copy with
+ * the middle one through an atomic index.
+ *
+ * Two copies are not enough: after publishing, the writer would have to
+ * wait for the reader to let go of the other copy before writing the next
+ * tick. The third copy is the one in transit, so the writer always has a
+ * free copy to write and the reader always has a complete one to read,
+ * whatever their rates. Unread snapshots are overwritten by newer ones.
+ */
+template<class T>
+class SnapshotBuffer
+{
+public:
+    SnapshotBuffer() : back(0), front(1), middle(2) {}
+    explicit SnapshotBuffer(const T &initial)
+        : back(0), front(1), middle(2)
+    {
+        for (int i = 0; i < 3; i++)
+            slots[i] = initial;
+    }
+
+    /** Writer only, the copy to fill. Holds an older snapshot, not the last one */
+    T& getBack() { return slots[back]; }
+
+    /** Writer only, makes the back copy the newest snapshot */
+    void publish() {
+        back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & INDEX_MASK;
+    }
+
+    /**
+     * @brief Reader only, picks up the newest snapshot if any
+     *
+     * @return bool false if nothing was published since the last call
+     */
+    bool acquire() {
+        if ((middle.load(std::memory_order_relaxed) & FRESH) == 0)
+            return false;
+        front = middle.exchange(front, std::memory_order_acq_rel) & INDEX_MASK;
+        return true;
+    }
+
+    /** Reader only, valid until the next acquire() */
+    const T& getFront() const { return slots[front]; }
+
+private:
+    static const unsigned int INDEX_MASK = 3;
+    static const unsigned int FRESH = 4;    // published and not acquired yet
+
+    SnapshotBuffer(const SnapshotBuffer&);
+    SnapshotBuffer& operator=(const SnapshotBuffer&);
+
+    T slots[3];
+    unsigned int back;                      // writer's
+    unsigned int front;                     // reader's
+    std::atomic<unsigned int> middle;
+};
+
+/**
+ * @brief What the renderer needs of a simulation tick
+ *
+ * Arrays are indexed by render object. To interpolate at render time, the
+ * renderer keeps a copy of the snapshot it acquired before the current one
+ * (getFront() is valid only until the next acquire()).
+ */
+struct RenderSnapshot
+{
+    RenderSnapshot() : tick(0), seconds(0.0) {}
+
+    uint64_t tick;
+    double   seconds;                     // simulated time of the tick
+    std::vector<Matrix44> transforms;
+    std::vector<Vector4>  colors;
+    std::vector<unsigned char> visible;
+};
+
+}
+
+#endif // SM_SNAPSHOTBUFFER_H
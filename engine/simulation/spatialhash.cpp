@@ -0,0 +1,450 @@
+/*
+ * Example of the OpenGL usage with SDL2
+ * Copyright (C) 2013 Matteo De Carlo <matteo.dek@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "spatialhash.h"
+#include "../jobs/jobsystem.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <functional>
+
+using namespace sm;
+
+namespace {
+    const int MAX_CHUNKS = 8;
+    // queries per job in the batched queries
+    const int QUERY_GRAIN = 256;
+
+    struct RadiusVisitor {
+        const float *x, *y, *z;
+        const int *index;
+        float px, py, pz, radius2;
+        int exclude;
+        int *results;
+        int maxResults;
+        int found;
+
+        void operator()(int sorted) {
+            const float dx = x[sorted] - px, dy = y[sorted] - py, dz = z[sorted] - pz;
+            if (dx*dx + dy*dy + dz*dz > radius2 || index[sorted] == exclude || found == maxResults)
+                return;
+            results[found++] = index[sorted];
+        }
+    };
+
+    struct NearestVisitor {
+        const float *x, *y, *z;
+        const int *index;
+        float px, py, pz, radius2;
+        int exclude;
+        int *results;
+        float *distances;
+        int k;
+        int found;
+
+        void operator()(int sorted) {
+            const float dx = x[sorted] - px, dy = y[sorted] - py, dz = z[sorted] - pz;
+            const float distance = dx*dx + dy*dy + dz*dz;
+            if (distance > radius2 || index[sorted] == exclude)
+                return;
+            if (found == k && distance >= distances[k-1])
+                return;
+
+            // insertion into the sorted list
+            int at = found < k ? found++ : k - 1;
+            while (at > 0 && distances[at-1] > distance) {
+                distances[at] = distances[at-1];
+                results[at] = results[at-1];
+                at--;
+            }
+            distances[at] = distance;
+            results[at] = index[sorted];
+        }
+    };
+}
+
+SpatialHash::SpatialHash(float cellSize, bool planar)
+    : planar(planar), tableMask(0), xBits(0), yBits(0), zBits(0), chunkCount(1), pointCount(0),
+      inputX(nullptr), inputY(nullptr), inputZ(nullptr)
+{
+    setCellSize(cellSize);
+    bucketStart.assign(2, 0);
+    for (int i = 0; i < 3; i++) {
+        boundsMin[i] = boundsMax[i] = 0.0f;
+        cellMin[i] = cellMax[i] = 0;
+    }
+}
+
+int SpatialHash::cellCoordinate(float value) const
+{
+    return int(std::floor(value * inverseCellSize));
+}
+
+int SpatialHash::bucketOf(int cx, int cy, int cz) const
+{
+    // the grid wrapped around a table of cells, rather than a random hash:
+    // cells close in space stay close in memory
+    const uint32_t x = uint32_t(cx) & ((1u << xBits) - 1);
+    const uint32_t z = uint32_t(cz) & ((1u << zBits) - 1);
+    uint32_t bucket = x | z << xBits;
+    if (!planar)
+        bucket |= (uint32_t(cy) & ((1u << yBits) - 1)) << (xBits + zBits);
+    return int(bucket);
+}
+
+uint64_t SpatialHash::cellKey(int cx, int cy, int cz) const
+{
+    // 21 bits per coordinate, the query compares nearby cells only
+    const uint64_t mask = (uint64_t(1) << 21) - 1;
+    return (uint64_t(uint32_t(cx)) & mask) | (planar ? 0 : (uint64_t(uint32_t(cy)) & mask) << 21) |
+           (uint64_t(uint32_t(cz)) & mask) << 42;
+}
+
+void SpatialHash::run(int count, int grain, JobSystem *jobs, void (SpatialHash::*phase)(int, int))
+{
+    if (jobs == nullptr) {
+        (this->*phase)(0, count);
+        return;
+    }
+    jobs->parallelFor(0, count, [this, phase](int begin, int end) { (this->*phase)(begin, end); }, grain);
+}
+
+void SpatialHash::build(const float *x, const float *y, const float *z, int count, JobSystem *jobs)
+{
+    inputX = x;
+    inputY = y;
+    inputZ = z;
+    pointCount = count;
+
+    int tableBits = 0;
+    while ((1 << tableBits) < count)
+        tableBits++;
+    const int tableSize = 1 << tableBits;
+    tableMask = tableSize - 1;
+    if (planar) {
+        xBits = (tableBits + 1) / 2;
+        yBits = 0;
+    } else {
+        xBits = (tableBits + 2) / 3;
+        yBits = (tableBits - xBits) / 2;
+    }
+    zBits = tableBits - xBits - yBits;
+    chunkCount = jobs != nullptr ? std::min(MAX_CHUNKS, jobs->getWorkerCount() + 1) : 1;
+    if (chunkCount > count)
+        chunkCount = count > 0 ? count : 1;
+
+    // resizes allocate only when the count grows
+    bucket.resize(count);
+    cell.resize(count);
+    chunkBounds.resize(size_t(chunkCount) * 6);
+    histogram.assign(size_t(chunkCount) * tableSize, 0);
+    bucketStart.resize(tableSize + 1);
+    sortedIndex.resize(count);
+    sortedX.resize(count);
+    sortedY.resize(count);
+    sortedZ.resize(count);
+    sortedCell.resize(count);
+
+    run(count, 0, jobs, &SpatialHash::computeBuckets);
+    run(chunkCount, 1, jobs, &SpatialHash::countChunks);
+
+    for (int i = 0; i < 3; i++) {
+        boundsMin[i] = chunkBounds[i];
+        boundsMax[i] = chunkBounds[3 + i];
+        for (int chunk = 1; chunk < chunkCount; chunk++) {
+            boundsMin[i] = std::min(boundsMin[i], chunkBounds[chunk * 6 + i]);
+            boundsMax[i] = std::max(boundsMax[i], chunkBounds[chunk * 6 + 3 + i]);
+        }
+        cellMin[i] = cellCoordinate(boundsMin[i]);
+        cellMax[i] = cellCoordinate(boundsMax[i]);
+    }
+    if (planar)
+        cellMin[1] = cellMax[1] = 0;
+    run(tableSize, 0, jobs, &SpatialHash::sumChunks);
+
+    // bucket totals to bucket starts
+    int total = 0;
+    for (int b = 0; b < tableSize; b++) {
+        const int size = bucketStart[b];
+        bucketStart[b] = total;
+        total += size;
+    }
+    bucketStart[tableSize] = total;
+
+    run(tableSize, 0, jobs, &SpatialHash::offsetChunks);
+    run(chunkCount, 1, jobs, &SpatialHash::scatterChunks);
+
+    inputX = inputY = inputZ = nullptr;
+}
+
+void SpatialHash::computeBuckets(int begin, int end)
+{
+    for (int i = begin; i < end; i++) {
+        const int cx = cellCoordinate(inputX[i]), cy = cellCoordinate(inputY[i]), cz = cellCoordinate(inputZ[i]);
+        bucket[i] = bucketOf(cx, cy, cz);
+        cell[i] = cellKey(cx, cy, cz);
+    }
+}
+
+void SpatialHash::countChunks(int begin, int end)
+{
+    const size_t tableSize = size_t(tableMask) + 1;
+    for (int chunk = begin; chunk < end; chunk++) {
+        int *counts = &histogram[chunk * tableSize];
+        const int first = int(int64_t(pointCount) * chunk / chunkCount);
+        const int last = int(int64_t(pointCount) * (chunk + 1) / chunkCount);
+        float minX = FLT_MAX, minY = FLT_MAX, minZ = FLT_MAX;
+        float maxX = -FLT_MAX, maxY = -FLT_MAX, maxZ = -FLT_MAX;
+        for (int i = first; i < last; i++) {
+            counts[bucket[i]]++;
+            minX = std::min(minX, inputX[i]);
+            maxX = std::max(maxX, inputX[i]);
+            minY = std::min(minY, inputY[i]);
+            maxY = std::max(maxY, inputY[i]);
+            minZ = std::min(minZ, inputZ[i]);
+            maxZ = std::max(maxZ, inputZ[i]);
+        }
+        float *bounds = &chunkBounds[chunk * 6];
+        bounds[0] = minX;
+        bounds[1] = minY;
+        bounds[2] = minZ;
+        bounds[3] = maxX;
+        bounds[4] = maxY;
+        bounds[5] = maxZ;
+    }
+}
+
+void SpatialHash::sumChunks(int begin, int end)
+{
+    // per chunk counts to offsets inside the bucket, bucket sizes to bucketStart
+    const size_t tableSize = size_t(tableMask) + 1;
+    for (int b = begin; b < end; b++) {
+        int sum = 0;
+        for (int chunk = 0; chunk < chunkCount; chunk++) {
+            int &count = histogram[chunk * tableSize + b];
+            const int size = count;
+            count = sum;
+            sum += size;
+        }
+        bucketStart[b] = sum;
+    }
+}
+
+void SpatialHash::offsetChunks(int begin, int end)
+{
+    const size_t tableSize = size_t(tableMask) + 1;
+    for (int b = begin; b < end; b++) {
+        for (int chunk = 0; chunk < chunkCount; chunk++)
+            histogram[chunk * tableSize + b] += bucketStart[b];
+    }
+}
+
+void SpatialHash::scatterChunks(int begin, int end)
+{
+    const size_t tableSize = size_t(tableMask) + 1;
+    for (int chunk = begin; chunk < end; chunk++) {
+        int *offsets = &histogram[chunk * tableSize];
+        const int first = int(int64_t(pointCount) * chunk / chunkCount);
+        const int last = int(int64_t(pointCount) * (chunk + 1) / chunkCount);
+        for (int i = first; i < last; i++) {
+            const int at = offsets[bucket[i]]++;
+            sortedIndex[at] = i;
+            sortedX[at] = inputX[i];
+            sortedY[at] = inputY[i];
+            sortedZ[at] = inputZ[i];
+            sortedCell[at] = cell[i];
+        }
+    }
+}
+
+template<class Visitor>
+void SpatialHash::visitCells(float x, float y, float z, float radius, Visitor &visit) const
+{
+    if (sortedIndex.empty())
+        return;
+
+    // clamped to the points' box before converting, the sphere may be huge
+    const float loX = std::max(x - radius, boundsMin[0]), hiX = std::min(x + radius, boundsMax[0]);
+    const float loZ = std::max(z - radius, boundsMin[2]), hiZ = std::min(z + radius, boundsMax[2]);
+    if (!(loX <= hiX && loZ <= hiZ))
+        return;
+    int minY = 0, maxY = 0;
+    if (!planar) {
+        const float loY = std::max(y - radius, boundsMin[1]), hiY = std::min(y + radius, boundsMax[1]);
+        if (!(loY <= hiY))
+            return;
+        minY = cellCoordinate(loY);
+        maxY = cellCoordinate(hiY);
+    }
+
+    visitBox(cellCoordinate(loX), cellCoordinate(hiX), minY, maxY, cellCoordinate(loZ), cellCoordinate(hiZ), visit);
+}
+
+template<class Visitor>
+void SpatialHash::visitBox(int minX, int maxX, int minY, int maxY, int minZ, int maxZ, Visitor &visit) const
+{
+    for (int cx = minX; cx <= maxX; cx++) {
+        for (int cy = minY; cy <= maxY; cy++) {
+            for (int cz = minZ; cz <= maxZ; cz++) {
+                const int b = bucketOf(cx, cy, cz);
+                const uint64_t key = cellKey(cx, cy, cz);
+                for (int sorted = bucketStart[b]; sorted < bucketStart[b+1]; sorted++) {
+                    // buckets are shared by distant cells, visit each point once
+                    if (sortedCell[sorted] == key)
+                        visit(sorted);
+                }
+            }
+        }
+    }
+}
+
+template<class Visitor>
+void SpatialHash::visitShell(int cx, int cy, int cz, int distance, Visitor &visit) const
+{
+    // the faces of the cube of cells around (cx, cy, cz), inside the points' box
+    const int minY = std::max(cy - distance, cellMin[1]), maxY = std::min(cy + distance, cellMax[1]);
+    const int minZ = std::max(cz - distance, cellMin[2]), maxZ = std::min(cz + distance, cellMax[2]);
+    if (cx - distance >= cellMin[0])
+        visitBox(cx - distance, cx - distance, minY, maxY, minZ, maxZ, visit);
+    if (distance > 0 && cx + distance <= cellMax[0])
+        visitBox(cx + distance, cx + distance, minY, maxY, minZ, maxZ, visit);
+
+    const int innerMinX = std::max(cx - distance + 1, cellMin[0]), innerMaxX = std::min(cx + distance - 1, cellMax[0]);
+    if (innerMinX > innerMaxX)
+        return;
+    int innerMinY = 0, innerMaxY = 0;
+    if (!planar) {
+        if (cy - distance >= cellMin[1])
+            visitBox(innerMinX, innerMaxX, cy - distance, cy - distance, minZ, maxZ, visit);
+        if (cy + distance <= cellMax[1])
+            visitBox(innerMinX, innerMaxX, cy + distance, cy + distance, minZ, maxZ, visit);
+        innerMinY = std::max(cy - distance + 1, cellMin[1]);
+        innerMaxY = std::min(cy + distance - 1, cellMax[1]);
+        if (innerMinY > innerMaxY)
+            return;
+    }
+    if (cz - distance >= cellMin[2])
+        visitBox(innerMinX, innerMaxX, innerMinY, innerMaxY, cz - distance, cz - distance, visit);
+    if (cz + distance <= cellMax[2])
+        visitBox(innerMinX, innerMaxX, innerMinY, innerMaxY, cz + distance, cz + distance, visit);
+}
+
+int SpatialHash::queryRadius(float x, float y, float z, float radius, int *results, int maxResults, int exclude) const
+{
+    RadiusVisitor visitor;
+    visitor.x = sortedX.data();
+    visitor.y = sortedY.data();
+    visitor.z = sortedZ.data();
+    visitor.index = sortedIndex.data();
+    visitor.px = x;
+    visitor.py = y;
+    visitor.pz = z;
+    visitor.radius2 = radius * radius;
+    visitor.exclude = exclude;
+    visitor.results = results;
+    visitor.maxResults = maxResults;
+    visitor.found = 0;
+    visitCells(x, y, z, radius, visitor);
+    return visitor.found;
+}
+
+int SpatialHash::queryNearest(float x, float y, float z, int k, float maxRadius, int *results,
+                              float *squaredDistances, int exclude) const
+{
+    if (k <= 0)
+        return 0;
+
+    NearestVisitor visitor;
+    visitor.x = sortedX.data();
+    visitor.y = sortedY.data();
+    visitor.z = sortedZ.data();
+    visitor.index = sortedIndex.data();
+    visitor.px = x;
+    visitor.py = y;
+    visitor.pz = z;
+    visitor.radius2 = maxRadius * maxRadius;
+    visitor.exclude = exclude;
+    visitor.results = results;
+    visitor.distances = squaredDistances;
+    visitor.k = k;
+    visitor.found = 0;
+    if (sortedIndex.empty())
+        return 0;
+
+    // shells around the cell of the query clamped into the points' box:
+    // the points are at least as far from the query as from its clamp
+    const float p[3] = {
+        std::min(std::max(x, boundsMin[0]), boundsMax[0]),
+        std::min(std::max(y, boundsMin[1]), boundsMax[1]),
+        std::min(std::max(z, boundsMin[2]), boundsMax[2])
+    };
+    int center[3];
+    float gap = cellSize;   // from the clamped query to the faces of its cell
+    int lastShell = 0;
+    for (int i = 0; i < 3; i++) {
+        if (planar && i == 1) {
+            center[i] = 0;
+            continue;
+        }
+        center[i] = cellCoordinate(p[i]);
+        const float low = p[i] - center[i] * cellSize;
+        gap = std::min(gap, std::max(0.0f, std::min(low, cellSize - low)));
+        lastShell = std::max(lastShell, std::max(center[i] - cellMin[i], cellMax[i] - center[i]));
+    }
+
+    for (int distance = 0; distance <= lastShell; distance++) {
+        visitShell(center[0], center[1], center[2], distance, visitor);
+        // the points of the next shells are at least this far
+        const float reach = distance * cellSize + gap;
+        if (reach > maxRadius || (visitor.found == k && squaredDistances[k-1] <= reach * reach))
+            break;
+    }
+    return visitor.found;
+}
+
+void SpatialHash::queryAllRadius(float radius, int *results, int *counts, int maxResults, JobSystem *jobs) const
+{
+    const std::function<void(int, int)> body = [=](int begin, int end) {
+        for (int sorted = begin; sorted < end; sorted++) {
+            const int point = sortedIndex[sorted];
+            counts[point] = queryRadius(sortedX[sorted], sortedY[sorted], sortedZ[sorted], radius,
+                                        results + size_t(point) * maxResults, maxResults, point);
+        }
+    };
+    if (jobs != nullptr)
+        jobs->parallelFor(0, getCount(), body, QUERY_GRAIN);
+    else
+        body(0, getCount());
+}
+
+void SpatialHash::queryAllNearest(int k, float maxRadius, int *results, float *squaredDistances, int *counts,
+                                  JobSystem *jobs) const
+{
+    const std::function<void(int, int)> body = [=](int begin, int end) {
+        for (int sorted = begin; sorted < end; sorted++) {
+            const int point = sortedIndex[sorted];
+            counts[point] = queryNearest(sortedX[sorted], sortedY[sorted], sortedZ[sorted], k, maxRadius,
+                                         results + size_t(point) * k, squaredDistances + size_t(point) * k, point);
+        }
+    };
+    if (jobs != nullptr)
+        jobs->parallelFor(0, getCount(), body, QUERY_GRAIN);
+    else
+        body(0, getCount());
+}
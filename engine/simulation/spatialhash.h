@@ -0,0 +1,149 @@
+/*
+ * Example of the OpenGL usage with SDL2
+ * Copyright (C) 2013 Matteo De Carlo <matteo.dek@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef SM_SPATIALHASH_H
+#define SM_SPATIALHASH_H
+
+#include <cstdint>
+#include <vector>
+
+namespace sm {
+
+class JobSystem;
+
+/**
+ * @brief Neighbour queries over many moving points, e.g. pedestrians
+ *
+ * build() maps every point to a grid cell, and the grid is wrapped around a
+ * table of as many buckets as points (cells far apart share a bucket, near
+ * ones don't). Points are counting sorted by bucket, so the points of a cell are contiguous, with a copy of
+ * their positions in the same order. The sort is split in chunks: each
+ * chunk counts its own histogram, the per chunk offsets are prefix summed
+ * and each chunk scatters its points, all in parallel on the JobSystem.
+ * The result is the same with or without jobs.
+ *
+ * Queries write into caller provided arrays, and build() reuses its arrays
+ * once the number of points is stable, so nothing is allocated per tick.
+ * Batched queries walk the points in cell order, so neighbouring queries
+ * touch the same cells.
+ */
+class SpatialHash
+{
+public:
+    /**
+     * @param cellSize about the typical query radius
+     * @param planar cells are columns over the x/z plane, for agents on the
+     * ground; distances are still measured in 3D
+     */
+    explicit SpatialHash(float cellSize = 1.0f, bool planar = true);
+
+    void setCellSize(float size) { cellSize = size; inverseCellSize = 1.0f / size; }
+    float getCellSize() const { return cellSize; }
+
+    /** Rebuilds the hash over "count" points given as x, y, z arrays */
+    void build(const float *x, const float *y, const float *z, int count, JobSystem *jobs = nullptr);
+    int getCount() const { return int(sortedIndex.size()); }
+
+    /**
+     * @brief Points within "radius" of (x, y, z)
+     *
+     * @param results receives up to maxResults point indices, unordered
+     * @param exclude a point index to skip, e.g. the querying one
+     * @return int number of results written
+     */
+    int queryRadius(float x, float y, float z, float radius, int *results, int maxResults, int exclude = -1) const;
+    /**
+     * @brief The "k" points nearest to (x, y, z) within "maxRadius"
+     *
+     * Cells are searched in shells of growing distance, stopping once the
+     * k found are nearer than the next shell, so the cost follows the
+     * distance of the k-th point rather than maxRadius, which may be
+     * infinite.
+     *
+     * @param results receives the point indices, nearest first
+     * @param squaredDistances receives their squared distances
+     * @return int number of results written, at most k
+     */
+    int queryNearest(float x, float y, float z, int k, float maxRadius, int *results, float *squaredDistances,
+                     int exclude = -1) const;
+
+    /**
+     * @brief queryRadius() around every point of the last build(), itself
+     * excluded
+     *
+     * Point "i" writes its neighbours to results[i * maxResults] and their
+     * number to counts[i].
+     */
+    void queryAllRadius(float radius, int *results, int *counts, int maxResults, JobSystem *jobs = nullptr) const;
+    /** queryNearest() around every point, laid out like queryAllRadius() */
+    void queryAllNearest(int k, float maxRadius, int *results, float *squaredDistances, int *counts,
+                         JobSystem *jobs = nullptr) const;
+
+private:
+    int cellCoordinate(float value) const;
+    int bucketOf(int cx, int cy, int cz) const;
+    /** Unique key of a cell, to tell apart the cells sharing a bucket */
+    uint64_t cellKey(int cx, int cy, int cz) const;
+    /** Calls visit(sorted) for the points in the cells overlapping the sphere */
+    template<class Visitor>
+    void visitCells(float x, float y, float z, float radius, Visitor &visit) const;
+    /** Calls visit(sorted) for the points in the cells of the box, bounds included */
+    template<class Visitor>
+    void visitBox(int minX, int maxX, int minY, int maxY, int minZ, int maxZ, Visitor &visit) const;
+    /** visitBox() over the cells "distance" cells away from (cx, cy, cz) on some axis */
+    template<class Visitor>
+    void visitShell(int cx, int cy, int cz, int distance, Visitor &visit) const;
+    void run(int count, int grain, JobSystem *jobs, void (SpatialHash::*phase)(int, int));
+
+    // build phases
+    void computeBuckets(int begin, int end);
+    void countChunks(int begin, int end);
+    void sumChunks(int begin, int end);
+    void offsetChunks(int begin, int end);
+    void scatterChunks(int begin, int end);
+
+    float cellSize;
+    float inverseCellSize;
+    bool  planar;
+
+    int tableMask;
+    int xBits, yBits, zBits;            // of the bucket index
+    int chunkCount;
+    int pointCount;
+    const float *inputX, *inputY, *inputZ;  // valid during build() only
+
+    std::vector<int> bucket;            // per input point
+    std::vector<uint64_t> cell;         // per input point
+    std::vector<float> chunkBounds;     // [chunk][min xyz, max xyz]
+    std::vector<int> histogram;         // [chunk][bucket]
+    std::vector<int> bucketStart;       // per bucket, plus the end
+
+    // points sorted by bucket
+    std::vector<int>   sortedIndex;
+    std::vector<float> sortedX, sortedY, sortedZ;
+    std::vector<uint64_t> sortedCell;
+
+    // box of the points, queries don't look outside it
+    float boundsMin[3], boundsMax[3];
+    int cellMin[3], cellMax[3];         // y is 0 when planar
+};
+
+}
+
+#endif // SM_SPATIALHASH_H
@@ -0,0 +1,426 @@
+/*
+ * Example of the OpenGL usage with SDL2
+ * Copyright (C) 2013 Matteo De Carlo <matteo.dek@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "traffic.h"
+#include "../jobs/jobsystem.h"
+#include <algorithm>
+#include <cmath>
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define SM_TRAFFIC_SSE
+#include <xmmintrin.h>
+#endif
+
+using namespace sm;
+
+namespace {
+    // gap used when nothing is ahead
+    const float FREE_ROAD_GAP = 10000.0f;
+    // lower bounds keeping the IDM formula finite
+    const float MIN_GAP = 0.1f;
+    const float MIN_DESIRED_SPEED = 0.1f;
+}
+
+TrafficSimulation::TrafficSimulation()
+    : nextVehicleId(0), vehicleCount(0), arrivedCount(0), laneChangeCount(0), stepDt(0)
+{
+}
+
+int TrafficSimulation::addLane(float length, float speedLimit)
+{
+    lanes.push_back(Lane());
+    lanes.back().length = length;
+    lanes.back().speedLimit = speedLimit;
+    return int(lanes.size()) - 1;
+}
+
+void TrafficSimulation::setNeighbours(int lane, int left, int right)
+{
+    lanes[lane].left = left;
+    lanes[lane].right = right;
+}
+
+void TrafficSimulation::connect(int from, int to)
+{
+    lanes[from].successors.push_back(to);
+}
+
+int TrafficSimulation::addVehicle(int lane, float position, float desiredSpeed, float length)
+{
+    Lane vehicle;
+    vehicle.position.push_back(position);
+    vehicle.speed.push_back(0.0f);
+    vehicle.acceleration.push_back(0.0f);
+    vehicle.desiredSpeed.push_back(desiredSpeed);
+    vehicle.vehicleLength.push_back(length);
+    vehicle.cooldown.push_back(0.0f);
+    vehicle.id.push_back(nextVehicleId);
+    vehicle.change.push_back(0);
+
+    Lane &target = lanes[lane];
+    insertVehicle(target, upperBound(target, position), vehicle, 0);
+    vehicleCount++;
+    return nextVehicleId++;
+}
+
+void TrafficSimulation::idmAccelerations(const IdmParameters &idm, int count, const float *gap, const float *speed,
+                                         const float *approach, const float *desiredSpeed, float *acceleration)
+{
+    const float brakingTerm = 1.0f / (2.0f * std::sqrt(idm.maxAcceleration * idm.comfortableDeceleration));
+
+    int i = 0;
+#ifdef SM_TRAFFIC_SSE
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 minGap = _mm_set1_ps(MIN_GAP);
+    const __m128 minDesired = _mm_set1_ps(MIN_DESIRED_SPEED);
+    const __m128 s0 = _mm_set1_ps(idm.minimumGap);
+    const __m128 headway = _mm_set1_ps(idm.timeHeadway);
+    const __m128 braking = _mm_set1_ps(brakingTerm);
+    const __m128 aMax = _mm_set1_ps(idm.maxAcceleration);
+    const __m128 floor = _mm_set1_ps(-idm.maxDeceleration);
+
+    for (; i + 4 <= count; i += 4) {
+        const __m128 s = _mm_max_ps(_mm_loadu_ps(gap + i), minGap);
+        const __m128 v = _mm_loadu_ps(speed + i);
+        const __m128 dv = _mm_loadu_ps(approach + i);
+        const __m128 v0 = _mm_max_ps(_mm_loadu_ps(desiredSpeed + i), minDesired);
+
+        __m128 ratio = _mm_div_ps(v, v0);
+        ratio = _mm_mul_ps(ratio, ratio);
+        ratio = _mm_mul_ps(ratio, ratio);
+
+        // desired gap s* = s0 + max(0, v T + v dv / (2 sqrt(a b)))
+        __m128 dynamic = _mm_mul_ps(v, _mm_add_ps(headway, _mm_mul_ps(dv, braking)));
+        __m128 desiredGap = _mm_add_ps(s0, _mm_max_ps(dynamic, zero));
+        __m128 interaction = _mm_div_ps(desiredGap, s);
+        interaction = _mm_mul_ps(interaction, interaction);
+
+        __m128 a = _mm_mul_ps(aMax, _mm_sub_ps(_mm_sub_ps(one, ratio), interaction));
+        _mm_storeu_ps(acceleration + i, _mm_max_ps(a, floor));
+    }
+#endif
+
+    for (; i < count; i++) {
+        const float s = std::max(gap[i], MIN_GAP);
+        const float v = speed[i];
+        const float v0 = std::max(desiredSpeed[i], MIN_DESIRED_SPEED);
+        float ratio = v / v0;
+        ratio *= ratio;
+        ratio *= ratio;
+        const float desiredGap = idm.minimumGap + std::max(0.0f, v * (idm.timeHeadway + approach[i] * brakingTerm));
+        float interaction = desiredGap / s;
+        interaction *= interaction;
+        acceleration[i] = std::max(idm.maxAcceleration * (1.0f - ratio - interaction), -idm.maxDeceleration);
+    }
+}
+
+int TrafficSimulation::successorOf(const Lane &lane, int vehicleId) const
+{
+    if (lane.successors.empty())
+        return -1;
+    return lane.successors[vehicleId % lane.successors.size()];
+}
+
+void TrafficSimulation::leaderBeyondEnd(const Lane &lane, int last, float &gap, float &leaderSpeed) const
+{
+    const int next = successorOf(lane, lane.id[last]);
+    if (next < 0 || lanes[next].position.empty()) {
+        gap = FREE_ROAD_GAP;
+        leaderSpeed = lane.speed[last];
+        return;
+    }
+
+    const Lane &nextLane = lanes[next];
+    gap = lane.length - lane.position[last] + nextLane.position[0] - nextLane.vehicleLength[0];
+    leaderSpeed = nextLane.speed[0];
+}
+
+void TrafficSimulation::followLane(int index)
+{
+    Lane &lane = lanes[index];
+    const int count = int(lane.position.size());
+    if (count == 0)
+        return;
+
+    lane.gap.resize(count);
+    lane.approach.resize(count);
+    lane.limit.resize(count);
+
+    for (int i = 0; i < count - 1; i++) {
+        lane.gap[i] = lane.position[i+1] - lane.vehicleLength[i+1] - lane.position[i];
+        lane.approach[i] = lane.speed[i] - lane.speed[i+1];
+    }
+    float leaderSpeed;
+    leaderBeyondEnd(lane, count - 1, lane.gap[count-1], leaderSpeed);
+    lane.approach[count-1] = lane.speed[count-1] - leaderSpeed;
+
+    for (int i = 0; i < count; i++)
+        lane.limit[i] = std::min(lane.desiredSpeed[i], lane.speedLimit);
+
+    idmAccelerations(idm, count, lane.gap.data(), lane.speed.data(), lane.approach.data(),
+                     lane.limit.data(), lane.acceleration.data());
+}
+
+void TrafficSimulation::evaluateLaneChange(int index)
+{
+    Lane &lane = lanes[index];
+    const int count = int(lane.position.size());
+    lane.change.assign(count, 0);
+    if (count == 0)
+        return;
+
+    lane.incentive.assign(count, mobil.threshold);
+    if (lane.left >= 0)
+        evaluateSide(index, lane.left, -1);
+    if (lane.right >= 0)
+        evaluateSide(index, lane.right, 1);
+}
+
+void TrafficSimulation::evaluateSide(int index, int targetIndex, signed char side)
+{
+    Lane &lane = lanes[index];
+    const Lane &target = lanes[targetIndex];
+    const int count = int(lane.position.size());
+    const int targetCount = int(target.position.size());
+
+    lane.gap.resize(count);
+    lane.approach.resize(count);
+    lane.limit.resize(count);
+    lane.speedScratch.resize(count);
+    lane.ownGap.resize(count);
+    lane.followerGap.resize(count);
+    lane.follower.resize(count);
+    for (int r = 0; r < 3; r++)
+        lane.result[r].resize(count);
+
+    // 1. the vehicle itself behind its new leader, found with a merge walk
+    int j = 0;
+    for (int i = 0; i < count; i++) {
+        const float position = lane.position[i];
+        while (j < targetCount && target.position[j] <= position)
+            j++;
+        lane.follower[i] = j - 1;
+        if (j < targetCount) {
+            lane.gap[i] = target.position[j] - target.vehicleLength[j] - position;
+            lane.approach[i] = lane.speed[i] - target.speed[j];
+        } else {
+            lane.gap[i] = FREE_ROAD_GAP;
+            lane.approach[i] = 0.0f;
+        }
+        lane.ownGap[i] = lane.gap[i];
+        lane.limit[i] = std::min(lane.desiredSpeed[i], target.speedLimit);
+    }
+    idmAccelerations(idm, count, lane.gap.data(), lane.speed.data(), lane.approach.data(),
+                     lane.limit.data(), lane.result[0].data());
+
+    // 2. the new follower behind the vehicle
+    for (int i = 0; i < count; i++) {
+        const int f = lane.follower[i];
+        if (f >= 0) {
+            lane.gap[i] = lane.position[i] - lane.vehicleLength[i] - target.position[f];
+            lane.speedScratch[i] = target.speed[f];
+            lane.approach[i] = target.speed[f] - lane.speed[i];
+            lane.limit[i] = std::min(target.desiredSpeed[f], target.speedLimit);
+        } else {
+            lane.gap[i] = FREE_ROAD_GAP;
+            lane.speedScratch[i] = 0.0f;
+            lane.approach[i] = 0.0f;
+            lane.limit[i] = 1.0f;
+        }
+        lane.followerGap[i] = lane.gap[i];
+    }
+    idmAccelerations(idm, count, lane.gap.data(), lane.speedScratch.data(), lane.approach.data(),
+                     lane.limit.data(), lane.result[1].data());
+
+    // 3. the old follower, once the vehicle is gone
+    for (int i = 0; i < count; i++) {
+        if (i > 0 && i + 1 < count) {
+            lane.gap[i] = lane.position[i+1] - lane.vehicleLength[i+1] - lane.position[i-1];
+            lane.approach[i] = lane.speed[i-1] - lane.speed[i+1];
+        } else if (i > 0) {
+            // the front vehicle leaves: the follower sees the next lane
+            float leaderSpeed;
+            leaderBeyondEnd(lane, i - 1, lane.gap[i], leaderSpeed);
+            lane.approach[i] = lane.speed[i-1] - leaderSpeed;
+        } else {
+            lane.gap[i] = FREE_ROAD_GAP;
+            lane.approach[i] = 0.0f;
+        }
+        lane.speedScratch[i] = i > 0 ? lane.speed[i-1] : 0.0f;
+        lane.limit[i] = i > 0 ? std::min(lane.desiredSpeed[i-1], lane.speedLimit) : 1.0f;
+    }
+    idmAccelerations(idm, count, lane.gap.data(), lane.speedScratch.data(), lane.approach.data(),
+                     lane.limit.data(), lane.result[2].data());
+
+    for (int i = 0; i < count; i++) {
+        if (lane.cooldown[i] > 0.0f || lane.position[i] >= target.length)
+            continue;
+        if (lane.ownGap[i] <= 0.0f || lane.followerGap[i] <= 0.0f)
+            continue;
+
+        const int f = lane.follower[i];
+        float othersGain = 0.0f;
+        if (f >= 0) {
+            // safety criterion
+            if (lane.result[1][i] < -mobil.safeDeceleration)
+                continue;
+            othersGain += lane.result[1][i] - target.acceleration[f];
+        }
+        if (i > 0)
+            othersGain += lane.result[2][i] - lane.acceleration[i-1];
+
+        const float gain = lane.result[0][i] - lane.acceleration[i] + mobil.politeness * othersGain;
+        if (gain > lane.incentive[i]) {
+            lane.incentive[i] = gain;
+            lane.change[i] = side;
+        }
+    }
+}
+
+void TrafficSimulation::applyLaneChanges()
+{
+    for (size_t index = 0; index < lanes.size(); index++) {
+        Lane &lane = lanes[index];
+        for (int i = int(lane.position.size()) - 1; i >= 0; i--) {
+            if (lane.change[i] == 0)
+                continue;
+
+            Lane &target = lanes[lane.change[i] < 0 ? lane.left : lane.right];
+            const float position = lane.position[i];
+            const int j = upperBound(target, position);
+
+            // neighbours may have moved in during this pass, check again
+            const int targetCount = int(target.position.size());
+            if (j < targetCount && target.position[j] - target.vehicleLength[j] <= position)
+                continue;
+            if (j > 0 && position - lane.vehicleLength[i] <= target.position[j-1])
+                continue;
+
+            insertVehicle(target, j, lane, i);
+            target.cooldown[j] = mobil.cooldown;
+            eraseVehicle(lane, i);
+            laneChangeCount++;
+        }
+    }
+}
+
+void TrafficSimulation::integrateLane(int index)
+{
+    Lane &lane = lanes[index];
+    const int count = int(lane.position.size());
+    const float dt = stepDt;
+
+    for (int i = 0; i < count; i++) {
+        const float speed = lane.speed[i];
+        const float newSpeed = std::max(0.0f, speed + lane.acceleration[i] * dt);
+        lane.position[i] += 0.5f * (speed + newSpeed) * dt;
+        lane.speed[i] = newSpeed;
+        lane.cooldown[i] -= dt;
+    }
+
+    // large steps may overshoot the leader, keep the lane sorted
+    for (int i = count - 2; i >= 0; i--) {
+        const float rear = lane.position[i+1] - lane.vehicleLength[i+1];
+        if (lane.position[i] > rear) {
+            lane.position[i] = rear;
+            lane.speed[i] = std::min(lane.speed[i], lane.speed[i+1]);
+        }
+    }
+}
+
+void TrafficSimulation::transferVehicles()
+{
+    for (size_t index = 0; index < lanes.size(); index++) {
+        Lane &lane = lanes[index];
+        while (!lane.position.empty() && lane.position.back() >= lane.length) {
+            const int last = int(lane.position.size()) - 1;
+            const int next = successorOf(lane, lane.id[last]);
+            if (next < 0) {
+                arrivedCount++;
+                vehicleCount--;
+            } else {
+                Lane &nextLane = lanes[next];
+                const float position = lane.position[last] - lane.length;
+                const int at = upperBound(nextLane, position);
+                insertVehicle(nextLane, at, lane, last);
+                nextLane.position[at] = position;
+                if (next == int(index)) {
+                    // a loop, the vehicle moved down the same arrays
+                    eraseVehicle(lane, last + 1);
+                    continue;
+                }
+            }
+            eraseVehicle(lane, last);
+        }
+    }
+}
+
+void TrafficSimulation::insertVehicle(Lane &lane, int at, const Lane &from, int index)
+{
+    lane.position.insert(lane.position.begin() + at, from.position[index]);
+    lane.speed.insert(lane.speed.begin() + at, from.speed[index]);
+    lane.acceleration.insert(lane.acceleration.begin() + at, from.acceleration[index]);
+    lane.desiredSpeed.insert(lane.desiredSpeed.begin() + at, from.desiredSpeed[index]);
+    lane.vehicleLength.insert(lane.vehicleLength.begin() + at, from.vehicleLength[index]);
+    lane.cooldown.insert(lane.cooldown.begin() + at, from.cooldown[index]);
+    lane.id.insert(lane.id.begin() + at, from.id[index]);
+    lane.change.insert(lane.change.begin() + at, 0);
+}
+
+void TrafficSimulation::eraseVehicle(Lane &lane, int index)
+{
+    lane.position.erase(lane.position.begin() + index);
+    lane.speed.erase(lane.speed.begin() + index);
+    lane.acceleration.erase(lane.acceleration.begin() + index);
+    lane.desiredSpeed.erase(lane.desiredSpeed.begin() + index);
+    lane.vehicleLength.erase(lane.vehicleLength.begin() + index);
+    lane.cooldown.erase(lane.cooldown.begin() + index);
+    lane.id.erase(lane.id.begin() + index);
+    lane.change.erase(lane.change.begin() + index);
+}
+
+int TrafficSimulation::upperBound(const Lane &lane, float position)
+{
+    return int(std::upper_bound(lane.position.begin(), lane.position.end(), position) - lane.position.begin());
+}
+
+void TrafficSimulation::forEachLane(JobSystem *jobs, void (TrafficSimulation::*phase)(int))
+{
+    const int count = int(lanes.size());
+    if (jobs == nullptr) {
+        for (int lane = 0; lane < count; lane++)
+            (this->*phase)(lane);
+        return;
+    }
+
+    jobs->parallelFor(0, count, [this, phase](int begin, int end) {
+        for (int lane = begin; lane < end; lane++)
+            (this->*phase)(lane);
+    });
+}
+
+void TrafficSimulation::step(float dt, JobSystem *jobs)
+{
+    stepDt = dt;
+    forEachLane(jobs, &TrafficSimulation::followLane);
+    forEachLane(jobs, &TrafficSimulation::evaluateLaneChange);
+    applyLaneChanges();
+    forEachLane(jobs, &TrafficSimulation::integrateLane);
+    transferVehicles();
+}
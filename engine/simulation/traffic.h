@@ -0,0 +1,179 @@
+/*
+ * Example of the OpenGL usage with SDL2
+ * Copyright (C) 2013 Matteo De Carlo <matteo.dek@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef SM_TRAFFIC_H
+#define SM_TRAFFIC_H
+
+#include <vector>
+
+namespace sm {
+
+class JobSystem;
+
+/** Intelligent Driver Model parameters, shared by all the vehicles */
+struct IdmParameters
+{
+    IdmParameters()
+        : maxAcceleration(1.5f), comfortableDeceleration(2.0f), minimumGap(2.0f),
+          timeHeadway(1.5f), maxDeceleration(9.0f) {}
+
+    float maxAcceleration;          // m/s^2
+    float comfortableDeceleration;  // m/s^2
+    float minimumGap;               // m, bumper to bumper when stopped
+    float timeHeadway;              // s
+    float maxDeceleration;          // m/s^2, physical limit of the result
+};
+
+/** MOBIL lane change parameters */
+struct MobilParameters
+{
+    MobilParameters()
+        : politeness(0.3f), threshold(0.2f), safeDeceleration(4.0f), cooldown(3.0f) {}
+
+    float politeness;       // weight of the other drivers' advantage
+    float threshold;        // m/s^2, minimum advantage to change
+    float safeDeceleration; // m/s^2, the new follower must not brake harder
+    float cooldown;         // s, between two changes of the same vehicle
+};
+
+/**
+ * @brief Microscopic traffic simulation on a lane graph
+ *
+ * Lanes are one way, with optional left/right neighbour lanes (lane change)
+ * and successor lanes (junctions). Vehicles live in the arrays of their
+ * lane, structure of arrays, sorted by position: the leader of vehicle "i"
+ * is "i + 1". The last vehicle of a lane follows the first one of the
+ * successor lane it is heading to.
+ *
+ * step() runs in phases, each one over all the lanes, split across the
+ * JobSystem if given:
+ *  - car following: IDM accelerations, computed 4 vehicles at a time with
+ *    SSE on gaps gathered from the sorted arrays;
+ *  - lane change: MOBIL, gathering the neighbours in the adjacent lane with
+ *    a merge walk of the two sorted lanes and evaluating the three IDM
+ *    accelerations it needs with the same SIMD kernel;
+ *  - the accepted lane changes are applied, serially since they touch two
+ *    lanes;
+ *  - integration, and transfer of the vehicles past the end of their lane.
+ */
+class TrafficSimulation
+{
+public:
+    TrafficSimulation();
+
+    int addLane(float length, float speedLimit);
+    /** Adjacent lanes in the same direction, -1 for none */
+    void setNeighbours(int lane, int left, int right);
+    /** Vehicles reaching the end of "from" continue on "to" */
+    void connect(int from, int to);
+
+    /**
+     * @brief Adds a vehicle on "lane" at "position" meters from its start
+     *
+     * @return int the vehicle id
+     */
+    int addVehicle(int lane, float position, float desiredSpeed, float length = 4.5f);
+
+    void setIdmParameters(const IdmParameters &parameters) { idm = parameters; }
+    void setMobilParameters(const MobilParameters &parameters) { mobil = parameters; }
+
+    /**
+     * @brief Advances the simulation by "dt" seconds
+     *
+     * @param jobs if not null, lanes are processed in parallel on it
+     */
+    void step(float dt, JobSystem *jobs = nullptr);
+
+    int getLaneCount() const { return int(lanes.size()); }
+    int getVehicleCount() const { return vehicleCount; }
+    /** Vehicles that left the network through a lane without successors */
+    int getArrivedCount() const { return arrivedCount; }
+    int getLaneChangeCount() const { return laneChangeCount; }
+
+    /** Vehicles of "lane" as of the last step(), sorted by position */
+    int getLaneVehicleCount(int lane) const { return int(lanes[lane].position.size()); }
+    const float* getLanePositions(int lane) const { return lanes[lane].position.data(); }
+    const float* getLaneSpeeds(int lane) const { return lanes[lane].speed.data(); }
+    const int* getLaneVehicleIds(int lane) const { return lanes[lane].id.data(); }
+
+    /**
+     * @brief IDM accelerations of "count" vehicles
+     *
+     * @param gap bumper to bumper distance from the leader
+     * @param approach own speed minus the leader speed
+     */
+    static void idmAccelerations(const IdmParameters &idm, int count, const float *gap, const float *speed,
+                                 const float *approach, const float *desiredSpeed, float *acceleration);
+
+private:
+    struct Lane {
+        Lane() : length(0), speedLimit(0), left(-1), right(-1) {}
+
+        float length;
+        float speedLimit;
+        int left, right;
+        std::vector<int> successors;
+
+        // per vehicle, sorted by position
+        std::vector<float> position;
+        std::vector<float> speed;
+        std::vector<float> acceleration;
+        std::vector<float> desiredSpeed;
+        std::vector<float> vehicleLength;
+        std::vector<float> cooldown;
+        std::vector<int>   id;
+        std::vector<signed char> change;   // -1 left, +1 right, 0 stay
+
+        // scratch arrays for the kernels, sized as the vehicles
+        std::vector<float> gap, approach, limit, speedScratch, result[3];
+        std::vector<float> ownGap, followerGap, incentive;
+        std::vector<int>   follower;
+    };
+
+    int  successorOf(const Lane &lane, int vehicleId) const;
+    /** Gap and speed of what is ahead of the last vehicle of "lane" */
+    void leaderBeyondEnd(const Lane &lane, int last, float &gap, float &leaderSpeed) const;
+
+    void followLane(int lane);
+    void evaluateLaneChange(int lane);
+    void evaluateSide(int lane, int target, signed char side);
+    void applyLaneChanges();
+    void integrateLane(int lane);
+    void transferVehicles();
+
+    static void insertVehicle(Lane &lane, int at, const Lane &from, int index);
+    static void eraseVehicle(Lane &lane, int index);
+    /** First vehicle of "lane" with position > "position" */
+    static int upperBound(const Lane &lane, float position);
+
+    void forEachLane(JobSystem *jobs, void (TrafficSimulation::*phase)(int));
+
+    std::vector<Lane> lanes;
+    IdmParameters   idm;
+    MobilParameters mobil;
+    int  nextVehicleId;
+    int  vehicleCount;
+    int  arrivedCount;
+    int  laneChangeCount;
+    float stepDt;       // of the step() running
+};
+
+}
+
+#endif // SM_TRAFFIC_H
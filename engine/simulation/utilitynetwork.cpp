@@ -0,0 +1,281 @@
+/*
+ * Example of the OpenGL usage with SDL2
+ * Copyright (C) 2013 Matteo De Carlo <matteo.dek@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "utilitynetwork.h"
+#include <algorithm>
+
+using namespace sm;
+
+UtilityNetwork::UtilityNetwork()
+    : componentCount(0), stamp(0)
+{
+}
+
+int UtilityNetwork::newComponent()
+{
+    int component;
+    if (!freeComponents.empty()) {
+        component = freeComponents.back();
+        freeComponents.pop_back();
+    } else {
+        component = int(components.size());
+        components.push_back(Component());
+    }
+
+    Component &c = components[component];
+    c.nodes.clear();
+    c.supply = c.demand = 0.0;
+    c.changed = false;
+    c.alive = true;
+    componentCount++;
+    return component;
+}
+
+void UtilityNetwork::markChanged(int component)
+{
+    if (!components[component].changed) {
+        components[component].changed = true;
+        changedComponents.push_back(component);
+    }
+}
+
+void UtilityNetwork::moveNode(int node, int to)
+{
+    Node &n = nodes[node];
+    Component &from = components[n.component];
+    const int last = from.nodes.back();
+    from.nodes[n.slot] = last;
+    nodes[last].slot = n.slot;
+    from.nodes.pop_back();
+    from.supply -= n.supply;
+    from.demand -= n.demand;
+
+    Component &target = components[to];
+    n.component = to;
+    n.slot = int(target.nodes.size());
+    target.nodes.push_back(node);
+    target.supply += n.supply;
+    target.demand += n.demand;
+}
+
+int UtilityNetwork::addNode(double supply, double demand)
+{
+    int node;
+    if (!freeNodes.empty()) {
+        node = freeNodes.back();
+        freeNodes.pop_back();
+    } else {
+        node = int(nodes.size());
+        nodes.push_back(Node());
+        visitStamp.push_back(0);
+    }
+
+    Node &n = nodes[node];
+    n.supply = supply;
+    n.demand = demand;
+    n.edges.clear();
+    n.alive = true;
+
+    const int component = newComponent();
+    Component &c = components[component];
+    n.component = component;
+    n.slot = 0;
+    c.nodes.push_back(node);
+    c.supply = supply;
+    c.demand = demand;
+    markChanged(component);
+    return node;
+}
+
+void UtilityNetwork::removeNode(int node)
+{
+    while (!nodes[node].edges.empty())
+        removeEdge(nodes[node].edges.back());
+
+    // now alone in its component
+    Node &n = nodes[node];
+    Component &c = components[n.component];
+    c.nodes.clear();
+    c.alive = false;
+    freeComponents.push_back(n.component);
+    componentCount--;
+
+    n.alive = false;
+    n.component = INVALID;
+    freeNodes.push_back(node);
+}
+
+void UtilityNetwork::setSupply(int node, double supply)
+{
+    Node &n = nodes[node];
+    components[n.component].supply += supply - n.supply;
+    n.supply = supply;
+    markChanged(n.component);
+}
+
+void UtilityNetwork::setDemand(int node, double demand)
+{
+    Node &n = nodes[node];
+    components[n.component].demand += demand - n.demand;
+    n.demand = demand;
+    markChanged(n.component);
+}
+
+float UtilityNetwork::getSatisfaction(int component) const
+{
+    const Component &c = components[component];
+    if (c.demand <= 0.0)
+        return 1.0f;
+    return float(std::min(1.0, c.supply / c.demand));
+}
+
+int UtilityNetwork::addEdge(int a, int b)
+{
+    int edge;
+    if (!freeEdges.empty()) {
+        edge = freeEdges.back();
+        freeEdges.pop_back();
+    } else {
+        edge = int(edges.size());
+        edges.push_back(Edge());
+    }
+
+    Edge &e = edges[edge];
+    e.a = a;
+    e.b = b;
+    e.alive = true;
+    e.slotA = int(nodes[a].edges.size());
+    nodes[a].edges.push_back(edge);
+    if (a != b) {
+        e.slotB = int(nodes[b].edges.size());
+        nodes[b].edges.push_back(edge);
+    } else {
+        e.slotB = e.slotA;
+    }
+
+    int into = nodes[a].component, from = nodes[b].component;
+    if (into == from)
+        return edge;
+
+    // relabel the smaller component
+    if (components[into].nodes.size() < components[from].nodes.size())
+        std::swap(into, from);
+    while (!components[from].nodes.empty())
+        moveNode(components[from].nodes.back(), into);
+
+    components[from].alive = false;
+    freeComponents.push_back(from);
+    componentCount--;
+    markChanged(into);
+    return edge;
+}
+
+void UtilityNetwork::detachEdge(int node, int slot)
+{
+    std::vector<int> &list = nodes[node].edges;
+    const int lastSlot = int(list.size()) - 1;
+    const int moved = list[lastSlot];
+    list[slot] = moved;
+    list.pop_back();
+    if (slot == lastSlot)
+        return;
+
+    Edge &m = edges[moved];
+    if (m.a == node && m.slotA == lastSlot)
+        m.slotA = slot;
+    if (m.b == node && m.slotB == lastSlot)
+        m.slotB = slot;
+}
+
+void UtilityNetwork::removeEdge(int edge)
+{
+    Edge &e = edges[edge];
+    const int a = e.a, b = e.b;
+    detachEdge(a, e.slotA);
+    if (a != b)
+        detachEdge(b, edges[edge].slotB);
+    edges[edge].alive = false;
+    freeEdges.push_back(edge);
+
+    if (a != b)
+        splitIfDisconnected(a, b);
+}
+
+void UtilityNetwork::splitIfDisconnected(int a, int b)
+{
+    if (stamp >= 0xFFFFFFFDu) {
+        std::fill(visitStamp.begin(), visitStamp.end(), 0);
+        stamp = 0;
+    }
+    stamp += 2;
+
+    const int start[2] = { a, b };
+    size_t head[2] = { 0, 0 };
+    for (int side = 0; side < 2; side++) {
+        queues[side].clear();
+        queues[side].push_back(start[side]);
+        visitStamp[start[side]] = stamp + side;
+    }
+
+    // expand one node of each side in turn
+    int closedSide = -1;
+    while (closedSide < 0) {
+        for (int side = 0; side < 2; side++) {
+            std::vector<int> &queue = queues[side];
+            if (head[side] == queue.size()) {
+                closedSide = side;
+                break;
+            }
+
+            const int node = queue[head[side]++];
+            const std::vector<int> &list = nodes[node].edges;
+            for (size_t i = 0; i < list.size(); i++) {
+                const Edge &e = edges[list[i]];
+                const int next = e.a == node ? e.b : e.a;
+                if (visitStamp[next] == stamp + 1 - side)
+                    return;  // met the other side, still connected
+                if (visitStamp[next] != stamp + side) {
+                    visitStamp[next] = stamp + side;
+                    queue.push_back(next);
+                }
+            }
+        }
+    }
+
+    const int old = nodes[a].component;
+    const int component = newComponent();
+    const std::vector<int> &piece = queues[closedSide];
+    for (size_t i = 0; i < piece.size(); i++)
+        moveNode(piece[i], component);
+
+    markChanged(old);
+    markChanged(component);
+}
+
+void UtilityNetwork::collectChanges(std::vector<int> &changed)
+{
+    changed.clear();
+    for (size_t i = 0; i < changedComponents.size(); i++) {
+        Component &c = components[changedComponents[i]];
+        if (c.changed && c.alive)
+            changed.push_back(changedComponents[i]);
+        c.changed = false;
+    }
+    changedComponents.clear();
+}
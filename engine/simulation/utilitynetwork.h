@@ -0,0 +1,123 @@
+/*
+ * Example of the OpenGL usage with SDL2
+ * Copyright (C) 2013 Matteo De Carlo <matteo.dek@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef SM_UTILITYNETWORK_H
+#define SM_UTILITYNETWORK_H
+
+#include <vector>
+
+namespace sm {
+
+/**
+ * @brief Connectivity and supply of a utility network (power, water)
+ *
+ * Nodes are producers (supply), consumers (demand) or plain junctions,
+ * edges are lines or pipes. Every node carries the label of its connected
+ * component, and every component the totals of its supply and demand, so
+ * asking whether a building is served is O(1) and an edit only touches the
+ * components it involves:
+ *  - adding an edge between two components relabels the smaller one into
+ *    the larger, so a node is relabelled at most log(n) times;
+ *  - removing an edge runs a breadth first search from both its ends, one
+ *    node at a time each. If they meet the component is still whole,
+ *    otherwise the search that runs out of nodes first has visited the
+ *    smaller piece, which is split off. The cost is proportional to the
+ *    smaller piece, unless a cycle keeps the component connected;
+ *  - changing the supply or demand of a node updates its component totals.
+ *
+ * The components changed by the edits are collected by collectChanges(), so
+ * the game only updates the buildings of those.
+ */
+class UtilityNetwork
+{
+public:
+    static const int INVALID = -1;
+
+    UtilityNetwork();
+
+    int addNode(double supply = 0.0, double demand = 0.0);
+    /** Removes "node" and all its edges */
+    void removeNode(int node);
+    void setSupply(int node, double supply);
+    void setDemand(int node, double demand);
+
+    int addEdge(int a, int b);
+    void removeEdge(int edge);
+
+    int getComponent(int node) const { return nodes[node].component; }
+    bool isConnected(int a, int b) const { return nodes[a].component == nodes[b].component; }
+    const std::vector<int>& getComponentNodes(int component) const { return components[component].nodes; }
+    double getSupply(int component) const { return components[component].supply; }
+    double getDemand(int component) const { return components[component].demand; }
+    /** Share of the demand of "component" that is met, between 0 and 1 */
+    float getSatisfaction(int component) const;
+    float getNodeSatisfaction(int node) const { return getSatisfaction(nodes[node].component); }
+    int getComponentCount() const { return componentCount; }
+
+    /**
+     * @brief The components whose nodes, supply or demand changed since the
+     * last call, components merged away are not reported
+     */
+    void collectChanges(std::vector<int> &changed);
+
+private:
+    struct Node {
+        double supply, demand;
+        int component;
+        int slot;                 // index in the component node list
+        std::vector<int> edges;
+        bool alive;
+    };
+
+    struct Edge {
+        int a, b;
+        int slotA, slotB;         // index in the edge lists of a and b
+        bool alive;
+    };
+
+    struct Component {
+        std::vector<int> nodes;
+        double supply, demand;
+        bool changed;
+        bool alive;
+    };
+
+    int newComponent();
+    void markChanged(int component);
+    void moveNode(int node, int to);
+    void detachEdge(int node, int slot);
+    /** Splits the component of a and b if the removed edge disconnected them */
+    void splitIfDisconnected(int a, int b);
+
+    std::vector<Node> nodes;
+    std::vector<Edge> edges;
+    std::vector<Component> components;
+    std::vector<int> freeNodes, freeEdges, freeComponents;
+    std::vector<int> changedComponents;
+    int componentCount;
+
+    // breadth first search state, visitStamp[node] is stamp or stamp + 1
+    std::vector<unsigned int> visitStamp;
+    unsigned int stamp;
+    std::vector<int> queues[2];
+};
+
+}
+
+#endif // SM_UTILITYNETWORK_H
@@ -34,8 +34,6 @@
  */
 class Timer 
 {
-Q_OBJECT
-
 public:
     explicit Timer()
     {
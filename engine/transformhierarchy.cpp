@@ -0,0 +1,228 @@
+/*
+    Example of the OpenGL usage with SDL2
+    Copyright (C) 2013  Matteo De Carlo <<matteo.dek@gmail.com>>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "transformhierarchy.h"
+#include <climits>
+
+using namespace sm;
+
+TransformHierarchy::TransformHierarchy()
+{
+    levelStart.push_back(0);
+    currentStamp = 1;
+    firstDirtyDepth = INT_MAX;
+    needsSort = false;
+    updatedCount = 0;
+}
+
+TransformHierarchy::NodeHandle TransformHierarchy::createNode(NodeHandle parentNode)
+{
+    int parentIndex = parentNode == NO_NODE ? -1 : handleToIndex[parentNode];
+    int nodeDepth = parentIndex < 0 ? 0 : depth[parentIndex] + 1;
+    int index = int(local.size());
+
+    NodeHandle handle;
+    if (freeHandles.empty()) {
+        handle = NodeHandle(handleToIndex.size());
+        handleToIndex.push_back(index);
+    } else {
+        handle = freeHandles.back();
+        freeHandles.pop_back();
+        handleToIndex[handle] = index;
+    }
+
+    // appending keeps the order only if the new node is in the last level
+    const int levels = int(levelStart.size()) - 1;
+    if (needsSort || nodeDepth < levels - 1) {
+        needsSort = true;
+    } else if (nodeDepth == levels) {
+        levelStart.push_back(index + 1);
+    } else {
+        levelStart.back() = index + 1;
+    }
+
+    local.push_back(Matrix44());
+    local.back().loadIdentity();
+    world.push_back(Matrix44());
+    localKind.push_back(MATRIX_IDENTITY);
+    worldKind.push_back(MATRIX_IDENTITY);
+    parent.push_back(parentIndex);
+    depth.push_back(nodeDepth);
+    dirtyStamp.push_back(currentStamp);
+    indexToHandle.push_back(handle);
+    removed.push_back(0);
+
+    if (nodeDepth < firstDirtyDepth)
+        firstDirtyDepth = nodeDepth;
+
+    return handle;
+}
+
+void TransformHierarchy::destroyNode(NodeHandle node)
+{
+    // descendants are found when sorting, parents always come first
+    removed[handleToIndex[node]] = 1;
+    needsSort = true;
+}
+
+void TransformHierarchy::setLocalMatrix(NodeHandle node, const Matrix44 &matrix)
+{
+    setLocalMatrix(node, matrix, matrix.classify());
+}
+
+void TransformHierarchy::setLocalMatrix(NodeHandle node, const Matrix44 &matrix, MatrixKind kind)
+{
+    int index = handleToIndex[node];
+    local[index].copyFrom(matrix);
+    localKind[index] = kind;
+    dirtyStamp[index] = currentStamp;
+    if (depth[index] < firstDirtyDepth)
+        firstDirtyDepth = depth[index];
+}
+
+void TransformHierarchy::applyWorldMatrix(NodeHandle node, MatrixStack &stack) const
+{
+    int index = handleToIndex[node];
+    stack.multiply(world[index], worldKind[index]);
+}
+
+/**
+ * Drops the destroyed subtrees and counting-sorts the nodes by depth,
+ * keeping the relative order inside each level.
+ */
+void TransformHierarchy::sortByDepth()
+{
+    const int count = int(local.size());
+
+    int levels = 0;
+    std::vector<int> levelCount;
+    for (int i = 0; i < count; i++) {
+        if (parent[i] >= 0 && removed[parent[i]])
+            removed[i] = 1;
+        if (removed[i]) {
+            freeHandles.push_back(indexToHandle[i]);
+            handleToIndex[indexToHandle[i]] = -1;
+            continue;
+        }
+        if (depth[i] >= levels) {
+            levels = depth[i] + 1;
+            levelCount.resize(levels, 0);
+        }
+        levelCount[depth[i]]++;
+    }
+
+    levelStart.assign(levels + 1, 0);
+    for (int level = 0; level < levels; level++)
+        levelStart[level + 1] = levelStart[level] + levelCount[level];
+
+    std::vector<int> newIndex(count, -1);
+    std::vector<int> next(levelStart.begin(), levelStart.end() - 1);
+    for (int i = 0; i < count; i++) {
+        if (!removed[i])
+            newIndex[i] = next[depth[i]]++;
+    }
+
+    const int survivors = levelStart[levels];
+    std::vector<Matrix44> newLocal(survivors), newWorld(survivors);
+    std::vector<MatrixKind> newLocalKind(survivors), newWorldKind(survivors);
+    std::vector<int> newParent(survivors), newDepth(survivors);
+    std::vector<unsigned int> newStamp(survivors);
+    std::vector<NodeHandle> newHandles(survivors);
+
+    for (int i = 0; i < count; i++) {
+        int n = newIndex[i];
+        if (n < 0)
+            continue;
+        newLocal[n] = local[i];
+        newWorld[n] = world[i];
+        newLocalKind[n] = localKind[i];
+        newWorldKind[n] = worldKind[i];
+        newParent[n] = parent[i] < 0 ? -1 : newIndex[parent[i]];
+        newDepth[n] = depth[i];
+        newStamp[n] = dirtyStamp[i];
+        newHandles[n] = indexToHandle[i];
+        handleToIndex[indexToHandle[i]] = n;
+    }
+
+    local.swap(newLocal);
+    world.swap(newWorld);
+    localKind.swap(newLocalKind);
+    worldKind.swap(newWorldKind);
+    parent.swap(newParent);
+    depth.swap(newDepth);
+    dirtyStamp.swap(newStamp);
+    indexToHandle.swap(newHandles);
+    removed.assign(survivors, 0);
+
+    needsSort = false;
+}
+
+void TransformHierarchy::updateRange(int begin, int end)
+{
+    int updated = 0;
+    for (int i = begin; i < end; i++) {
+        const int p = parent[i];
+        if (dirtyStamp[i] != currentStamp && (p < 0 || dirtyStamp[p] != currentStamp))
+            continue;
+
+        if (p < 0) {
+            world[i].copyFrom(local[i]);
+            worldKind[i] = localKind[i];
+        } else if (localKind[i] == MATRIX_IDENTITY) {
+            world[i].copyFrom(world[p]);
+            worldKind[i] = worldKind[p];
+        } else if (worldKind[p] != MATRIX_GENERAL && localKind[i] != MATRIX_GENERAL) {
+            world[i] = world[p].multiplyAffine(local[i]);
+            worldKind[i] = MATRIX_AFFINE;
+        } else {
+            world[i] = world[p] * local[i];
+            worldKind[i] = MATRIX_GENERAL;
+        }
+
+        // children see this node as changed
+        dirtyStamp[i] = currentStamp;
+        updated++;
+    }
+    updatedCount += updated;
+}
+
+void TransformHierarchy::update()
+{
+    update(ParallelFor(), INT_MAX);
+}
+
+void TransformHierarchy::update(const ParallelFor &parallelFor, int grain)
+{
+    if (needsSort)
+        sortByDepth();
+
+    updatedCount = 0;
+    const int levels = int(levelStart.size()) - 1;
+    for (int level = firstDirtyDepth; level < levels; level++) {
+        const int begin = levelStart[level];
+        const int end = levelStart[level + 1];
+        if (parallelFor && end - begin > grain)
+            parallelFor(begin, end, [this](int first, int last) { updateRange(first, last); });
+        else
+            updateRange(begin, end);
+    }
+
+    currentStamp++;
+    firstDirtyDepth = INT_MAX;
+}
@@ -0,0 +1,124 @@
+/*
+    Example of the OpenGL usage with SDL2
+    Copyright (C) 2013  Matteo De Carlo <<matteo.dek@gmail.com>>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef TRANSFORMHIERARCHY_H
+#define TRANSFORMHIERARCHY_H
+
+#include "math/math.h"
+#include "matrixstack.h"
+#include <atomic>
+#include <functional>
+#include <vector>
+
+namespace sm {
+
+/**
+ * @brief Scene graph of transforms stored as flat arrays
+ *
+ * Nodes are kept sorted by depth, so every depth level is a contiguous range
+ * and every parent comes before its children. update() walks the levels in
+ * order and recomputes the world matrix only of the nodes whose local matrix
+ * changed, or whose parent's world matrix changed. Nodes of the same level
+ * don't depend on each other, so each level can be split across threads.
+ *
+ * Nodes are referred by a stable NodeHandle, while their position in the
+ * arrays (the index) changes when the structure changes.
+ */
+class TransformHierarchy
+{
+public:
+    typedef int NodeHandle;
+    static const NodeHandle NO_NODE = -1;
+
+    /**
+     * @brief Runs body(begin, end) over sub-ranges covering [begin, end),
+     * possibly in parallel, and returns when all of them are done.
+     */
+    typedef std::function<void(int begin, int end, const std::function<void(int, int)> &body)> ParallelFor;
+
+    TransformHierarchy();
+
+    /**
+     * @brief Creates a node with an identity local matrix
+     *
+     * @param parent parent node, NO_NODE for a root
+     */
+    NodeHandle createNode(NodeHandle parent = NO_NODE);
+    /** Destroys "node" and all of its descendants */
+    void destroyNode(NodeHandle node);
+
+    void setLocalMatrix(NodeHandle node, const Matrix44 &matrix);
+    void setLocalMatrix(NodeHandle node, const Matrix44 &matrix, MatrixKind kind);
+    const Matrix44& getLocalMatrix(NodeHandle node) const { return local[handleToIndex[node]]; }
+
+    /** World matrix as of the last update() */
+    const Matrix44& getWorldMatrix(NodeHandle node) const { return world[handleToIndex[node]]; }
+
+    /** Multiplies the world matrix of "node" into the top of "stack" */
+    void applyWorldMatrix(NodeHandle node, MatrixStack &stack) const;
+
+    /** Recomputes the dirty world matrices on the calling thread */
+    void update();
+    /**
+     * @brief Recomputes the dirty world matrices, levels wider than "grain"
+     * nodes are split with "parallelFor"
+     */
+    void update(const ParallelFor &parallelFor, int grain = 4096);
+
+    /**
+     * @brief All the world matrices, contiguous, e.g. for an instance buffer
+     *
+     * Valid until the next structural change. Use getIndex() to find a
+     * node in it.
+     */
+    const Matrix44* getWorldMatrices() const { return world.data(); }
+    int getNodeCount() const { return int(world.size()); }
+    int getIndex(NodeHandle node) const { return handleToIndex[node]; }
+
+    /** Number of world matrices recomputed by the last update() */
+    int getUpdatedCount() const { return updatedCount; }
+
+private:
+    void sortByDepth();
+    void updateRange(int begin, int end);
+
+    // per node arrays, sorted by depth
+    std::vector<Matrix44>     local;
+    std::vector<Matrix44>     world;
+    std::vector<MatrixKind>   localKind;
+    std::vector<MatrixKind>   worldKind;
+    std::vector<int>          parent;      // index of the parent, -1 for roots
+    std::vector<int>          depth;
+    std::vector<unsigned int> dirtyStamp;  // == currentStamp if to be recomputed
+    std::vector<NodeHandle>   indexToHandle;
+    std::vector<char>         removed;     // destroyed, dropped at the next sort
+
+    std::vector<int> levelStart;   // first index of each depth, plus the end
+    std::vector<int> handleToIndex;
+    std::vector<NodeHandle> freeHandles;
+
+    unsigned int currentStamp;
+    int  firstDirtyDepth;          // no dirty nodes above this depth
+    bool needsSort;
+    std::atomic<int> updatedCount;
+};
+
+}
+
+#endif // TRANSFORMHIERARCHY_H
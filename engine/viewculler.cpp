@@ -0,0 +1,131 @@
+/*
+    Example of the OpenGL usage with SDL2
+    Copyright (C) 2013  Matteo De Carlo <<matteo.dek@gmail.com>>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "viewculler.h"
+#include "errorhandling.h"
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define SM_VIEWCULLER_SSE
+#include <xmmintrin.h>
+#endif
+
+using namespace sm;
+
+const int ViewCuller::MAX_VIEWS;
+
+ViewCuller::ViewCuller()
+{
+}
+
+int ViewCuller::addObject(const Vector3 &center, smReal radius)
+{
+    centerX.push_back(0);
+    centerY.push_back(0);
+    centerZ.push_back(0);
+    this->radius.push_back(0);
+    int object = getObjectCount() - 1;
+    setBounds(object, center, radius);
+    return object;
+}
+
+void ViewCuller::setBounds(int object, const Vector3 &center, smReal radius)
+{
+    const smReal *c = center.data();
+    centerX[object] = c[0];
+    centerY[object] = c[1];
+    centerZ[object] = c[2];
+    this->radius[object] = radius;
+}
+
+int ViewCuller::removeObject(int object)
+{
+    int last = getObjectCount() - 1;
+    centerX[object] = centerX[last];
+    centerY[object] = centerY[last];
+    centerZ[object] = centerZ[last];
+    radius[object] = radius[last];
+    centerX.pop_back();
+    centerY.pop_back();
+    centerZ.pop_back();
+    radius.pop_back();
+    return object == last ? -1 : last;
+}
+
+void ViewCuller::cull(const Vector4 *planes, int viewCount, std::vector<ViewMask> &masks) const
+{
+    if (viewCount > MAX_VIEWS) {
+        emitError("ViewCuller: too many views");
+        viewCount = MAX_VIEWS;
+    }
+
+    const int count = getObjectCount();
+    masks.resize(count);
+
+    int i = 0;
+#ifdef SM_VIEWCULLER_SSE
+    // planes splatted once, reused for every block of four objects
+    const int planeCount = viewCount * Frustum::PLANE_COUNT;
+    __m128 splat[MAX_VIEWS * Frustum::PLANE_COUNT * 4];
+    for (int p = 0; p < planeCount; p++) {
+        const smReal *plane = planes[p].data();
+        for (int k = 0; k < 4; k++)
+            splat[p*4+k] = _mm_set1_ps(plane[k]);
+    }
+
+    for (; i + 4 <= count; i += 4) {
+        const __m128 x = _mm_loadu_ps(&centerX[i]);
+        const __m128 y = _mm_loadu_ps(&centerY[i]);
+        const __m128 z = _mm_loadu_ps(&centerZ[i]);
+        const __m128 negRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&radius[i]));
+
+        ViewMask block[4] = { 0, 0, 0, 0 };
+        const __m128 *plane = splat;
+        for (int v = 0; v < viewCount; v++) {
+            __m128 outside = _mm_setzero_ps();
+            for (int p = 0; p < Frustum::PLANE_COUNT; p++, plane += 4) {
+                __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, plane[0]), _mm_mul_ps(y, plane[1])),
+                                             _mm_add_ps(_mm_mul_ps(z, plane[2]), plane[3]));
+                outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, negRadius));
+            }
+            const int visible = ~_mm_movemask_ps(outside);
+            for (int k = 0; k < 4; k++)
+                block[k] |= ViewMask((visible >> k) & 1) << v;
+        }
+
+        for (int k = 0; k < 4; k++)
+            masks[i+k] = block[k];
+    }
+#endif
+
+    // remaining objects, or all of them without SSE
+    for (; i < count; i++) {
+        ViewMask mask = 0;
+        const Vector4 *plane = planes;
+        for (int v = 0; v < viewCount; v++) {
+            bool inside = true;
+            for (int p = 0; p < Frustum::PLANE_COUNT; p++, plane++) {
+                const smReal *e = plane->data();
+                if (e[0]*centerX[i] + e[1]*centerY[i] + e[2]*centerZ[i] + e[3] < -radius[i])
+                    inside = false;
+            }
+            if (inside)
+                mask |= ViewMask(1) << v;
+        }
+        masks[i] = mask;
+    }
+}
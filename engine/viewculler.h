@@ -0,0 +1,76 @@
+/*
+    Example of the OpenGL usage with SDL2
+    Copyright (C) 2013  Matteo De Carlo <<matteo.dek@gmail.com>>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef VIEWCULLER_H
+#define VIEWCULLER_H
+
+#include "math/math.h"
+#include "math/frustum.h"
+#include <vector>
+
+namespace sm {
+
+/**
+ * @brief Culls bounding spheres against several frusta at once
+ *
+ * Spheres are stored as separate x, y, z, radius arrays, so four of them are
+ * tested against a plane with a handful of SSE instructions. cull() walks the
+ * spheres once and tests each block against the planes of every view,
+ * producing one bitmask per object: bit "v" is set if the object is at
+ * least partially inside view "v".
+ */
+class ViewCuller
+{
+public:
+    typedef unsigned int ViewMask;
+    static const int MAX_VIEWS = 32;
+
+    ViewCuller();
+
+    /** @return int the object index, stable until removeObject() */
+    int addObject(const Vector3 &center, smReal radius);
+    void setBounds(int object, const Vector3 &center, smReal radius);
+    /**
+     * @brief Swaps the last object into "object"
+     *
+     * @return int the old index of the object moved into "object", whose
+     * handle must be remapped, -1 if "object" was the last one
+     */
+    int removeObject(int object);
+    int getObjectCount() const { return int(radius.size()); }
+
+    /**
+     * @brief Tests every object against "viewCount" sets of planes
+     *
+     * @param planes viewCount * Frustum::PLANE_COUNT world space planes, as
+     * from Frustum::extractPlanes()
+     * @param masks receives getObjectCount() view masks
+     */
+    void cull(const Vector4 *planes, int viewCount, std::vector<ViewMask> &masks) const;
+
+private:
+    std::vector<smReal> centerX;
+    std::vector<smReal> centerY;
+    std::vector<smReal> centerZ;
+    std::vector<smReal> radius;
+};
+
+}
+
+#endif // VIEWCULLER_H